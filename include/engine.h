@@ -0,0 +1,47 @@
+/*
+ * Gesture engine, input event to uinput output pipeline.
+ */
+
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <stdio.h>
+#include <time.h>
+#include <linux/input.h>
+
+#include "uinput_api.h"
+
+struct gesture_param;
+struct recognizer;
+
+/* one engine per input device, the output and parameters may be shared */
+struct engine;
+
+/*
+ * Recognizer backends by name ("native", "grail"), NULL if unknown;
+ * engine_recognizer_name() enumerates them from 0 until it returns NULL.
+ * engine_new() runs the native one if rec is NULL.
+ */
+const struct recognizer *engine_find_recognizer(const char *name);
+const char *engine_recognizer_name(int i);
+/* whether the backend commits flicks before touch-up (flick_early) */
+int engine_early_flick(const struct recognizer *rec);
+
+struct engine *engine_new(struct uinput_api *ua,
+						  const struct gesture_param *param,
+						  const struct recognizer *rec);
+void engine_delete(struct engine *eng);
+void engine_event(struct engine *eng, const struct input_event *ev);
+void engine_set_param(struct engine *eng, const struct gesture_param *param);
+
+/*
+ * Account per-frame latency. clock is the clock of the input event
+ * timestamps (see EVIOCSCLOCKID); the end-to-end figure runs from the
+ * SYN_REPORT time stamped by the kernel to the return of the uinput write.
+ * With a writer thread that write is timed by the thread, and the engine
+ * itself stops the clock once the frame is in the ring ("queued").
+ */
+void engine_set_timing(struct engine *eng, clockid_t clock);
+void engine_print_stats(struct engine *eng, FILE *fp);
+
+#endif /* _ENGINE_H_ */
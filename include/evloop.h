@@ -0,0 +1,29 @@
+/*
+ * epoll based event loop.
+ */
+
+#ifndef _EVLOOP_H_
+#define _EVLOOP_H_
+
+#include <stdint.h>
+
+/* max. number of registered file descriptors */
+#define EVLOOP_DIM_SOURCES	16
+
+struct evloop;
+
+/* fd handler, events is the epoll event mask (EPOLLIN, EPOLLHUP, ...) */
+typedef void (*evloop_fd_cb)(struct evloop *loop, int fd,
+							 uint32_t events, void *data);
+/* signal handler, called from the loop, not from signal context */
+typedef void (*evloop_sig_cb)(struct evloop *loop, int signo, void *data);
+
+struct evloop *evloop_new();
+void evloop_destroy(struct evloop *loop);
+int evloop_add(struct evloop *loop, int fd, evloop_fd_cb cb, void *data);
+int evloop_del(struct evloop *loop, int fd);
+int evloop_signal(struct evloop *loop, int signo, evloop_sig_cb cb, void *data);
+int evloop_run(struct evloop *loop);
+void evloop_quit(struct evloop *loop);
+
+#endif /* _EVLOOP_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Binary input event recordings.
+ */
+
+#ifndef _EVREC_H_
+#define _EVREC_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <linux/input.h>
+
+/*
+ * File layout, all integers little endian:
+ *
+ *   header   magic "JGEVREC\0", u32 version, u32 desc_len,
+ *            u32 nevents, u32 nframes, u64 index_offset
+ *   desc     evemu device description text (desc_len bytes, optional)
+ *   events   per event: zigzag varint time delta (us) to the previous
+ *            event, or to 0 for the first one, u8 type, varint code,
+ *            zigzag varint value
+ *   index    per frame: u64 file offset of the first event,
+ *            u64 time (us) the first delta is relative to
+ *
+ * A frame is the run of events up to and including a SYN_REPORT.
+ */
+#define EVREC_MAGIC			"JGEVREC"
+#define EVREC_VERSION		1
+#define EVREC_HEADER_SIZE	32
+
+struct evrec_writer {
+	FILE		*fp;
+	uint64_t	offset;		/* file offset of the next event */
+	uint64_t	time;		/* time of the last event (us) */
+	uint32_t	desc_len;
+	uint32_t	nevents;
+	uint32_t	nframes;
+	int			frame_open;	/* events since the last SYN_REPORT */
+	uint64_t	*index;
+	uint32_t	index_size;
+};
+
+struct evrec {
+	const unsigned char	*map;
+	size_t				size;
+	const char			*desc;
+	uint32_t			desc_len;
+	uint32_t			nevents;
+	uint32_t			nframes;
+	const unsigned char	*index;
+
+	/* read cursor */
+	const unsigned char	*pos;
+	const unsigned char	*end;
+	uint64_t			time;
+};
+
+int evrec_write_begin(struct evrec_writer *w, FILE *fp,
+					  const char *desc, uint32_t desc_len);
+int evrec_write_event(struct evrec_writer *w, const struct input_event *ev);
+int evrec_write_end(struct evrec_writer *w);
+
+int evrec_probe(const char *path);
+struct evrec *evrec_open(const char *path);
+void evrec_close(struct evrec *r);
+int evrec_seek(struct evrec *r, uint32_t frame);
+int evrec_read(struct evrec *r, struct input_event *ev);
+
+#endif /* _EVREC_H_ */
@@ -9,10 +9,15 @@
 #include <stdint.h>
 #include <linux/input.h>
 
+#include "gesture_math.h"
+
 #define FRAME_STATUS_BEGIN	0
 #define FRAME_STATUS_UPDATE	1
 #define FRAME_STATUS_END	2
 
+/* upper bound of num_slots, one bit per slot in active_mask */
+#define FRAME_MAX_SLOTS		32
+
 /**
  * struct utouch_contact - surface contact details
  * @prev: pointer to same slot of previous frame
@@ -45,8 +50,8 @@ struct utouch_contact {
 	int slot;
 	unsigned int id;
 	int tool_type;
-	float x;
-	float y;
+	gcoord_t x;
+	gcoord_t y;
 	float touch_major;
 	float touch_minor;
 	float width_major;
@@ -72,6 +77,8 @@ typedef uint64_t utouch_frame_time_t;
  * @mod_time: time of last contact count change (ms)
  * @slot_mod_time: time of last slot id array change (ms)
  * @active: the array of active contacts
+ * @slots: contiguous array of num_slots contacts, indexed by slot
+ * @active_mask: bit n set while slots[n] is in use
  *
  * Contact frame details. Later versions of this struct may grow in
  * size, but will remain binary compatible with older versions.
@@ -91,11 +98,12 @@ struct utouch_frame {
 	utouch_frame_time_t mod_time;
 	utouch_frame_time_t slot_mod_time;
 	struct utouch_contact **active;
-	struct utouch_contact **slots;
+	struct utouch_contact *slots;
+	uint32_t active_mask;
 };
 
 struct utouch_frame *create_frame(int nslot);
-void destroy_frame(struct utouch_frame *frame, int nslot);
+void destroy_frame(struct utouch_frame *frame);
 int frame_active_nslot(struct utouch_frame *f);
 int frame_set_active_slot(struct utouch_frame *frame, int slot);
 int frame_get_slot_status(struct utouch_frame *frame);
@@ -14,26 +14,180 @@
 #define FM_R	2
 #define FM_A	3
 
-void gesture_init();
+/*
+ * Flicks report keypad ids (6: north, 3: south-east, ...) with 4 or 8
+ * directions. Other sector counts report FLICK_ID_SECTOR + sector,
+ * sector 0 centred on east and counting counter-clockwise.
+ */
+#define FLICK_ID_SECTOR	10
+#define FLICK_DIR_MAX	18		/* ids up to 27, below pinching */
+
+/* gesture id withdrawing an early flick, valuators[2] is its direction */
+#define FLICK_ID_CANCEL	30
+
+/* pinch ids, valuators[0..1] are the spread in mm */
+#define PINCH_ID_IN		28	/* zoom in */
+#define PINCH_ID_OUT	29	/* zoom out */
+
+/*
+ * struct gesture_param - thresholds and device parameters
+ *
+ * Filled by gesture_init() and gesture_load_config(), read-only while
+ * recognizing; a reload builds a new block. Lengths are in mm, times in
+ * ms, unless noted otherwise.
+ */
+struct gesture_param {
+	/* device parameters */
+	float screen_xres;		/* screen x resolution (pixel) */
+	float screen_yres;		/* screen y resolution (pixel) */
+	float device_xres;		/* panel x resolution (pixel) */
+	float device_yres;		/* panel y resolution (pixel) */
+	float phys_xsize;		/* panel size width (mm) */
+	float phys_ysize;		/* panel size height (mm) */
+	float mapped_xres;		/* mapping x resolution (pixel) */
+	float mapped_yres;		/* mapping y resolution (pixel) */
+	float scale_x;			/* mapping x pixel scale */
+	float scale_y;			/* mapping y pixel scale */
+	float scale_ppm_x;		/* pixel per mm */
+	float scale_ppm_y;		/* pixel per mm */
+	int   max_touch;		/* tracked contacts, up to FRAME_MAX_SLOTS */
+
+	/* flick threshold */
+	int   flick_dir;		/* number of directions, 3..FLICK_DIR_MAX */
+	float flick_dist_min_threshold;
+	float flick_dist_max_threshold;
+	float flick_velo_min_threshold;	/* ave. velocity min (mm/ms) */
+	float flick_time_min_threshold;
+	float flick_time_max_threshold;
+	float flick_velo_window;		/* release velocity window (ms), 0: stroke avg. */
+	int   flick_early;			/* report flicks before touch-up */
+
+	/* pinching threshold */
+	float pinch_dist_min_threshold;
+
+	/* touch position prediction */
+	float predict_horizon;		/* extrapolation (ms), 0: raw positions */
+	float predict_window;		/* fitted history (ms) */
+	float predict_max_dist;		/* max. extrapolation (mm) */
+
+	/* derived from the above in the engine number format */
+	gscale_t g_scale_x;
+	gscale_t g_scale_y;
+	gscale_t g_mm_x;			/* surface units to mm */
+	gscale_t g_mm_y;
+	gnum_sq_t g_flick_dist_min2;	/* thresholds squared */
+	gnum_sq_t g_flick_dist_max2;
+	gnum_sq_t g_flick_velo_min2;
+	gnum_t g_flick_velo_min;
+	gnum_t g_flick_sector[FLICK_DIR_MAX][2];	/* sector boundaries, y up */
+	gnum_t g_pinch_dist_min;
+	gscale_t g_pinch_wx;		/* pinch direction weights */
+	gscale_t g_pinch_wy;
+	utouch_frame_time_t flick_time_min_ms;
+	utouch_frame_time_t flick_time_max_ms;
+	utouch_frame_time_t flick_velo_window_ms;	/* 0: off */
+	int   predict_on;			/* predict_horizon > 0 */
+};
+
+/* recent positions of one contact, oldest first from (head - count) */
+#define MOTION_DIM_SAMPLES	16	/* power of two */
+
+struct motion_sample {
+	utouch_frame_time_t time;
+	gcoord_t x;
+	gcoord_t y;
+};
+
+struct motion_ring {
+	unsigned int head;
+	unsigned int count;
+	struct motion_sample s[MOTION_DIM_SAMPLES];
+};
+
+/* flick recognizer state */
+struct flick_state {
+	utouch_frame_time_t start_time;
+	gcoord_t pos_x;				/* last position */
+	gcoord_t pos_y;
+	gcoord_t org_x;				/* stroke origin */
+	gcoord_t org_y;
+	gnum_t distance[DIM_FM];
+	gnum_t velocity[DIM_FM];
+	gnum_sq_t dist2;		/* squared lengths of the above */
+	gnum_sq_t velo2;
+	int early_dir;			/* early commit candidate direction */
+	int committed;			/* direction reported before touch-up */
+	unsigned int committed_slot;
+};
+
+/* pinching recognizer state */
+struct pinch_state {
+	gnum_t distance[DIM_FM];
+	gnum_sq_t spread;		/* direction metric at the last report */
+};
+
+/*
+ * struct gesture_ctx - recognizer context of one touch session
+ *
+ * Holds all mutable recognizer state. Allocated by the caller, one per
+ * input device, so sessions never share state.
+ */
+struct gesture_ctx {
+	const struct gesture_param *param;
+	int multi_touch;
+	struct flick_state flick;
+	struct pinch_state pinch;
+	struct motion_ring motion[FRAME_MAX_SLOTS];
+};
+
+void gesture_init(struct gesture_param *param);
+int  gesture_load_config(struct gesture_param *param, const char *path);
+void gesture_ctx_init(struct gesture_ctx *ctx,
+					  const struct gesture_param *param);
 
 /* touch */
-void touch_init();
-void touch_down_event(struct uinput_api *ua, struct utouch_frame *f);
-void touch_up_event(struct uinput_api *ua, struct utouch_frame *f);
-void touch_move_event(struct uinput_api *ua, struct utouch_frame *f);
+void touch_init(struct gesture_ctx *ctx);
+void touch_down_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					  struct utouch_frame *f);
+void touch_up_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					struct utouch_frame *f);
+void touch_move_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					  struct utouch_frame *f);
+
+/* contact motion */
+void motion_begin(struct gesture_ctx *ctx, const struct utouch_frame *f);
+void motion_update(struct gesture_ctx *ctx, const struct utouch_frame *f);
+int  motion_velocity(const struct gesture_ctx *ctx,
+					 const struct utouch_frame *f, float window,
+					 float *vx, float *vy);
+int  motion_release_velocity(const struct gesture_ctx *ctx,
+							 const struct utouch_frame *f,
+							 gnum_t *vx, gnum_t *vy);
+void motion_set_horizon(struct gesture_param *param, float h);
+int  motion_predict(const struct gesture_ctx *ctx,
+					const struct utouch_frame *f, gcoord_t *x, gcoord_t *y);
 
 /* flick */
-void flick_init();
-void flick_set_dir_div(int d);
-void flick_reset(const struct utouch_frame *f);
-void flick_update(const struct utouch_frame *f);
-int  flick_check(const struct utouch_frame *f);
-void flick_event(struct uinput_api *ua, const struct utouch_frame *f);
+void flick_init(struct gesture_ctx *ctx);
+int flick_set_dir_div(struct gesture_param *param, int d);
+void flick_reset(struct gesture_ctx *ctx, const struct utouch_frame *f);
+void flick_update(struct gesture_ctx *ctx, const struct utouch_frame *f);
+int  flick_check(struct gesture_ctx *ctx, const struct utouch_frame *f);
+void flick_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+				 const struct utouch_frame *f);
+int  flick_commit_check(struct gesture_ctx *ctx, const struct utouch_frame *f);
+void flick_release(struct gesture_ctx *ctx, struct uinput_api *ua,
+				   const struct utouch_frame *f);
+int  flick_stroke(struct gesture_ctx *ctx, struct uinput_api *ua,
+				  float dx, float dy, float vx, float vy,
+				  utouch_frame_time_t dt);
 
 /* pinching */
-void pinch_init();
-void pinch_reset(const struct utouch_frame *f);
-int  pinch_check(const struct utouch_frame *f);
-void pinch_event(struct uinput_api *ua, const struct utouch_frame *f);
+void pinch_init(struct gesture_ctx *ctx);
+void pinch_set_weights(struct gesture_param *param);
+void pinch_reset(struct gesture_ctx *ctx, const struct utouch_frame *f);
+int  pinch_check(struct gesture_ctx *ctx, const struct utouch_frame *f);
+void pinch_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+				 const struct utouch_frame *f);
 
 #endif
@@ -0,0 +1,112 @@
+/*
+ * Number format of the gesture engine.
+ *
+ * By default the recognizers compute in float. Built with
+ * -DGESTURE_FIXED_POINT they use Q16.16 fixed point instead, for
+ * targets without a usable FPU. Code written against gnum_t and the
+ * macros below compiles either way; conversions from float are meant
+ * for parameter setup, not for the per-frame path.
+ */
+
+#ifndef _GESTURE_MATH_H_
+#define _GESTURE_MATH_H_
+
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+
+#ifdef GESTURE_FIXED_POINT
+
+typedef int32_t gnum_t;				/* Q16.16 */
+typedef int32_t gcoord_t;			/* surface units, as reported */
+typedef int64_t gscale_t;			/* Q32.32, resolution ratios */
+typedef int64_t gnum_sq_t;			/* Q32.32, squares of gnum_t */
+
+#define GNUM_SHIFT		16
+/* largest magnitude gnum_from_float() takes */
+#define GNUM_FLOAT_MAX		32767.0f
+/* constant expression, for static initializers */
+#define GNUM_CONST(f)		((gnum_t)((f) * (1 << GNUM_SHIFT) + ((f) < 0 ? -0.5 : 0.5)))
+#define gnum_from_float(f)	((gnum_t)lrintf((f) * (1 << GNUM_SHIFT)))
+#define gnum_to_float(a)	((float)(a) / (1 << GNUM_SHIFT))
+#define gnum_from_int(i)	((gnum_t)(i) * (1 << GNUM_SHIFT))
+/* truncates toward zero, like a float to int cast */
+#define gnum_to_int(a)		((a) < 0 ? -(-(a) >> GNUM_SHIFT) : (a) >> GNUM_SHIFT)
+#define gnum_mul(a, b)		((gnum_t)(((int64_t)(a) * (b)) >> GNUM_SHIFT))
+#define gnum_div_int(a, i)	((gnum_t)((a) / (int32_t)(i)))
+#define gnum_abs(a)			((a) < 0 ? -(a) : (a))
+#define gnum_sq_sum(a, b)	((int64_t)(a) * (a) + (int64_t)(b) * (b))
+#define gnum_sq_to_float(s)	((float)(s) / 4294967296.0f)
+
+/*
+ * Ratios are rounded up, so that i * n / d truncates to the exact
+ * result for surface coordinates i within the resolution d.
+ */
+#define gscale_from_ratio(n, d)	((gscale_t)ceil((double)(n) / (d) * 4294967296.0))
+#define gscale_apply(i, s)	((int32_t)(((int64_t)(i) * (s)) >> 32))
+/* mm per surface unit, and i surface units in mm */
+#define gscale_mm(res, size)	gscale_from_ratio(size, res)
+#define gnum_from_units(i, s)	((i) < 0 ? \
+	-(gnum_t)((-(int64_t)(i) * (s)) >> GNUM_SHIFT) : \
+	(gnum_t)(((int64_t)(i) * (s)) >> GNUM_SHIFT))
+
+/* square root of a gnum_sq_t, back in Q16 */
+static inline gnum_t gnum_sq_sqrt(gnum_sq_t s)
+{
+	uint64_t v = s;
+	uint64_t r = 0, bit = (uint64_t)1 << 62;
+
+	/* bitwise square root */
+	while (bit > v)
+		bit >>= 2;
+	while (bit) {
+		if (v >= r + bit) {
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (gnum_t)r;
+}
+
+#define gnum_hypot(a, b)	gnum_sq_sqrt(gnum_sq_sum(a, b))
+
+/* (a, b) projected onto (c, d), whose squared length d2 is not 0 */
+static inline gnum_t gnum_proj(gnum_t a, gnum_t b, gnum_t c, gnum_t d,
+							   gnum_sq_t d2)
+{
+	return (gnum_t)(((int64_t)a * c + (int64_t)b * d) / gnum_sq_sqrt(d2));
+}
+
+#else
+
+typedef float gnum_t;
+typedef float gcoord_t;
+typedef float gscale_t;
+typedef float gnum_sq_t;
+
+#define GNUM_FLOAT_MAX		FLT_MAX
+#define GNUM_CONST(f)		((gnum_t)(f))
+#define gnum_from_float(f)	((gnum_t)(f))
+#define gnum_to_float(a)	(a)
+#define gnum_from_int(i)	((gnum_t)(i))
+#define gnum_to_int(a)		((int32_t)(a))
+#define gnum_mul(a, b)		((a) * (b))
+#define gnum_div_int(a, i)	((a) / (i))
+#define gnum_abs(a)			fabsf(a)
+#define gnum_sq_sum(a, b)	((a) * (a) + (b) * (b))
+#define gnum_sq_to_float(s)	(s)
+#define gnum_sq_sqrt(s)		sqrtf(s)
+#define gnum_hypot(a, b)	hypotf(a, b)
+#define gnum_proj(a, b, c, d, d2)	(((a) * (c) + (b) * (d)) / sqrtf(d2))
+#define gscale_from_ratio(n, d)	((gscale_t)(n) / (d))
+#define gscale_apply(i, s)	((int32_t)((i) * (s)))
+/* kept as units per mm and divided, as the float engine always did */
+#define gscale_mm(res, size)	((gscale_t)(res) / (size))
+#define gnum_from_units(i, s)	((i) / (s))
+
+#endif /* GESTURE_FIXED_POINT */
+
+#endif /* _GESTURE_MATH_H_ */
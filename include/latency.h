@@ -0,0 +1,30 @@
+/*
+ * Log-scale latency histograms.
+ */
+
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/* 4 buckets per power of two, covers up to 2^40 ns (about 18 min) */
+#define LAT_SUB_BITS		2
+#define LAT_DIM_BUCKETS		(4 * 40)
+
+struct lat_hist {
+	const char	*name;
+	uint64_t	count;
+	uint64_t	max;		/* ns */
+	uint32_t	bucket[LAT_DIM_BUCKETS];
+};
+
+void lat_hist_init(struct lat_hist *h, const char *name);
+void lat_hist_add(struct lat_hist *h, uint64_t ns);
+uint64_t lat_hist_percentile(const struct lat_hist *h, double p);
+void lat_hist_print(const struct lat_hist *h, FILE *fp);
+
+uint64_t lat_now(clockid_t clk);
+
+#endif /* _LATENCY_H_ */
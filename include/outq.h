@@ -0,0 +1,51 @@
+/*
+ * Output frames handed to a writer thread.
+ */
+
+#ifndef _OUTQ_H_
+#define _OUTQ_H_
+
+#include <stdio.h>
+#include <pthread.h>
+#include <linux/input.h>
+
+#include "latency.h"
+
+/* ring size in events, a power of two */
+#define OUTQ_DIM_EVENTS		4096
+
+/*
+ * Single producer (the engine thread), single consumer (the writer).
+ * head is only written by the producer, tail only by the consumer; both
+ * run freely and are reduced modulo OUTQ_DIM_EVENTS on access.
+ */
+struct outq {
+	struct input_event	ev[OUTQ_DIM_EVENTS];
+	unsigned int	head;
+	unsigned int	tail;
+	int				fd;			/* output, owned by the caller */
+	int				efd;		/* eventfd, wakes the writer */
+	int				quit;
+	int				sleeping;	/* writer waits on efd */
+	pthread_t		thread;
+
+	/* producer side accounting */
+	unsigned long	frames;		/* batches queued */
+	unsigned long	events;
+	unsigned long	full;		/* batches refused, ring full */
+	unsigned long	wakes;		/* eventfd writes */
+	unsigned int	max_fill;	/* high water mark (events) */
+	/* consumer side */
+	unsigned long	errors;		/* events lost to write errors */
+	int				timing;		/* see outq_set_timing() */
+	clockid_t		clock;
+	struct lat_hist	lat_e2e;	/* event time stamp to write return */
+};
+
+struct outq *outq_new(int fd);
+void outq_destroy(struct outq *q);
+int outq_push(struct outq *q, const struct input_event *ev, int n);
+void outq_set_timing(struct outq *q, clockid_t clock);
+void outq_print_stats(const struct outq *q, FILE *fp);
+
+#endif /* _OUTQ_H_ */
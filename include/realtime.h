@@ -0,0 +1,27 @@
+/*
+ * Real-time setup of the daemon.
+ */
+
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+/* default SCHED_FIFO priority of --realtime */
+#define RT_DEFAULT_PRIO		50
+/* stack touched before the memory is locked */
+#define RT_STACK_PREFAULT	(64 * 1024)
+
+int rt_set_affinity(const char *cpus);
+int rt_set_priority(int prio);
+int rt_lock_memory();
+
+/*
+ * Heap allocation guard: while armed, calls into the allocator (malloc,
+ * calloc, realloc, reallocarray and the aligned variants) are counted,
+ * from any thread. The allocator is interposed for the whole binary,
+ * armed or not. Only available with glibc, rt_alloc_guard_ok() tells.
+ */
+int rt_alloc_guard_ok();
+void rt_alloc_guard_arm();
+unsigned long rt_alloc_guard_disarm();
+
+#endif /* _REALTIME_H_ */
@@ -0,0 +1,44 @@
+/*
+ * Gesture recognizer backends of the engine.
+ */
+
+#ifndef _RECOGNIZER_H_
+#define _RECOGNIZER_H_
+
+#include <linux/input.h>
+
+#include "frame.h"
+#include "uinput_api.h"
+
+struct gesture_param;
+
+/*
+ * struct recognizer - turns the frames of one engine into output
+ * @name: backend name, as selected on the command line
+ * @create: new recognizer state, one per engine
+ * @destroy: free the state
+ * @set_param: switch parameter blocks, called between two frames
+ * @event: optional, sees every input event but SYN_REPORT before the
+ *         frame does
+ * @sync: report the frame at SYN_REPORT; contacts that ended must be
+ *        made inactive (frame_set_slot_inactive()) here
+ * @early_flick: honours flick_early, commits flicks before touch-up
+ *
+ * The engine frames the contacts, stamps and flushes the output; the
+ * backend only queues pointer and gesture events.
+ */
+struct recognizer {
+	const char *name;
+	void *(*create)(const struct gesture_param *param);
+	void (*destroy)(void *rec);
+	void (*set_param)(void *rec, const struct gesture_param *param);
+	void (*event)(void *rec, const struct input_event *ev);
+	void (*sync)(void *rec, struct uinput_api *ua, struct utouch_frame *f,
+				 const struct input_event *syn);
+	int early_flick;
+};
+
+extern const struct recognizer native_recognizer;	/* engine_native.c */
+extern const struct recognizer grail_recognizer;	/* engine_grail.c */
+
+#endif /* _RECOGNIZER_H_ */
@@ -0,0 +1,32 @@
+/*
+ * Recorded input event streams.
+ */
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <linux/input.h>
+
+#include "mtdev-plumbing.h"
+
+struct evemu_device;
+
+/*
+ * struct replay - a recording loaded into memory
+ * @dev: recorded device description, NULL if the recording has none
+ * @events: the recorded kernel events
+ * @nevents: number of events
+ * @nframes: number of SYN_REPORT events
+ */
+struct replay {
+	struct evemu_device	*dev;
+	struct input_event	*events;
+	int					nevents;
+	int					nframes;
+};
+
+struct replay *replay_load(const char *path);
+void replay_free(struct replay *rp);
+int replay_init_mtdev(const struct replay *rp, struct mtdev *dev);
+
+#endif /* _REPLAY_H_ */
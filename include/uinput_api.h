@@ -5,17 +5,67 @@
 #ifndef _UINPUT_API_H_
 #define _UINPUT_API_H_
 
+#include <stdio.h>
 #include <sys/types.h>
+#include <sys/time.h>
+#include <time.h>
+#include <linux/input.h>
+
+struct outq;
+
+/* output queue, one frame_sync() pass plus a backlog if the reader lags */
+#define UINPUT_DIM_EVENTS	256
+
+/* slots of the multitouch output device */
+#define UINPUT_MAX_SLOTS	32
+
+/* last queued state of one multitouch output slot */
+struct uinput_slot {
+	int			id;			/* tracking id, -1 while up */
+	int			x, y;		/* -1 if unknown */
+};
 
 struct uinput_api {
 	int			fd;
+	int			sink;		/* no uinput device behind fd */
+	FILE		*fp;		/* evemu text output instead of fd */
+	struct timeval	time;	/* stamp for queued events */
+	/* last queued pointer state, no-op events are not sent again */
+	u_int32_t	abs_known;	/* bit per ABS_X..ABS_RY code */
+	int32_t		abs_last[ABS_RY + 1];
+	u_int32_t	key_known;	/* bit per code - BTN_MOUSE */
+	u_int32_t	key_down;
+	int			blocked;	/* reader lags, events kept back */
+	struct outq	*q;			/* writer thread, see uinput_start_writer() */
+	unsigned long	suppressed;
+	unsigned long	coalesced;
+	unsigned long	dropped;	/* lost to queue overrun */
+	unsigned long	gestures;	/* uinput_Gesture() reports */
+	/* multitouch (type B) output, see uinput_new_mt() */
+	int			mt_slots;	/* 0: two finger pointer output */
+	int			mt_slot;	/* last queued ABS_MT_SLOT, -1 if unknown */
+	u_int32_t	mt_active;	/* bit per slot with a contact */
+	u_int32_t	mt_reader;	/* bit per slot the reader may see in use */
+	int			mt_touch;	/* last queued BTN_TOUCH, -1 if unknown */
+	u_int16_t	mt_next_id;
+	struct uinput_slot	mt[UINPUT_MAX_SLOTS];
 	u_int8_t	gestureId;
 	u_int16_t	valuators[3];	
+	int			nevents;	/* pending events */
+	int			nreport;	/* pending events up to last SYN_REPORT */
+	struct input_event	events[UINPUT_DIM_EVENTS];
 };
 
 void uinput_write(struct uinput_api *ua, struct input_event *ie);
+void uinput_flush(struct uinput_api *ua);
 struct uinput_api *uinput_new();
+struct uinput_api *uinput_new_mt(int nslots);
+struct uinput_api *uinput_new_sink(int fd);
+struct uinput_api *uinput_new_file(FILE *fp, int mt_slots);
 void uinput_destroy(struct uinput_api *ua);
+int uinput_start_writer(struct uinput_api *ua);
+int uinput_set_timing(struct uinput_api *ua, clockid_t clock);
+void uinput_print_stats(const struct uinput_api *ua, FILE *fp);
 
 void uinput_PenDown_1st(struct uinput_api *ua);
 void uinput_PenUp_1st(struct uinput_api *ua);
@@ -24,6 +74,10 @@ void uinput_PenDown_2nd(struct uinput_api *ua);
 void uinput_PenUp_2nd(struct uinput_api *ua);
 void uinput_PenMove_2nd(struct uinput_api *ua);
 
+void uinput_MtDown(struct uinput_api *ua, int slot);
+void uinput_MtUp(struct uinput_api *ua, int slot);
+void uinput_MtMove(struct uinput_api *ua, int slot);
+
 void uinput_Gesture(struct uinput_api *ua);
 
 #endif /* _UINPUT_API_H_ */
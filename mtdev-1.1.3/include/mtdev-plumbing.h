@@ -101,6 +101,29 @@ int mtdev_configure(struct mtdev *dev, int fd);
  */
 int mtdev_fetch_event(struct mtdev *dev, int fd, struct input_event *ev);
 
+/**
+ * mtdev_fetch_span - fetch kernel events without copying
+ * @dev: the mtdev in use
+ * @fd: file descriptor of the kernel device
+ * @ev: set to point at the first fetched kernel event
+ *
+ * Like mtdev_fetch_event(), but points @ev at a contiguous run of
+ * kernel events in the read buffer. The device is only read when the
+ * buffer is empty. The events remain valid until
+ * mtdev_fetch_consume() is called.
+ *
+ * On success, returns the number of events in the run (0 if none).
+ * Otherwise, a standard negative error number is returned.
+ */
+int mtdev_fetch_span(struct mtdev *dev, int fd, const struct input_event **ev);
+
+/**
+ * mtdev_fetch_consume - release events obtained by mtdev_fetch_span()
+ * @dev: the mtdev in use
+ * @count: number of events to release, at most the run length
+ */
+void mtdev_fetch_consume(struct mtdev *dev, int count);
+
 /**
  * mtdev_put_event - put an event into the converter
  * @dev: the mtdev in use
@@ -159,6 +159,29 @@ int mtdev_idle(struct mtdev *dev, int fd, int ms);
  */
 int mtdev_get(struct mtdev *dev, int fd, struct input_event* ev, int ev_max);
 
+/**
+ * mtdev_get_span - get processed events from mtdev without copying
+ * @dev: the mtdev in use
+ * @fd: file descriptor of the kernel device
+ * @ev: set to point at the first available processed event
+ *
+ * Like mtdev_get(), but instead of copying the events, points @ev at
+ * a contiguous run of processed events inside mtdev. For type B
+ * devices this is the kernel read buffer itself. The events remain
+ * valid until mtdev_get_consume() is called.
+ *
+ * On success, returns the number of events in the run. Otherwise,
+ * a standard negative error number is returned.
+ */
+int mtdev_get_span(struct mtdev *dev, int fd, const struct input_event **ev);
+
+/**
+ * mtdev_get_consume - release events obtained by mtdev_get_span()
+ * @dev: the mtdev in use
+ * @count: number of events to release, at most the run length
+ */
+void mtdev_get_consume(struct mtdev *dev, int count);
+
 /**
  * mtdev_close - close the mtdev converter
  * @dev: the mtdev to close
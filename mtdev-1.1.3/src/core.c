@@ -30,6 +30,7 @@
 #include "iobuf.h"
 #include "evbuf.h"
 #include "match.h"
+#include "dist.h"
 
 static inline int istouch(const struct mtdev_slot *data,
 			  const struct mtdev *dev)
@@ -80,18 +81,16 @@ static void solve(struct mtdev_state *state, const struct mtdev *dev,
 		  int *nid, const int *nx, const int *ny, int nn,
 		  bitmask_t touch)
 {
-	int A[DIM2_FINGER], *row;
+	int A[DIM2_FINGER];
 	int n2s[DIM_FINGER];
 	int id, i, j;
 
 	/* setup distance matrix for contact matching */
-	for (j = 0; j < sn; j++) {
-		row = A + nn * j;
-		for (i = 0; i < nn; i++)
-			row[i] = dist2(nx[i] - sx[j], ny[i] - sy[j]);
-	}
+	mtdev_dist2_matrix(A, nx, ny, nn, sx, sy, sn);
 
-	mtdev_match(n2s, A, nn, sn);
+	/* a steady set of contacts usually pairs up by nearest neighbour */
+	if (!mtdev_match_nearest(n2s, A, nn, sn))
+		mtdev_match(n2s, A, nn, sn);
 
 	/* update matched contacts and create new ones */
 	foreach_bit(i, touch) {
@@ -194,22 +193,6 @@ static int process_typeA(struct mtdev_state *state,
 	return mtcnt ? size : -1;
 }
 
-/*
- * process_typeB - propagate events without parsing
- * @state: mtdev state
- *
- * This function is called when a SYN_REPORT is seen, right before
- * that event is pushed to the queue.
- */
-static void process_typeB(struct mtdev_state *state)
-{
-	struct input_event ev;
-	while (!evbuf_empty(&state->inbuf)) {
-		evbuf_get(&state->inbuf, &ev);
-		evbuf_put(&state->outbuf, &ev);
-	}
-}
-
 /*
  * filter_data - apply input filtering on new incoming data
  * @state: mtdev state
@@ -390,15 +373,26 @@ struct mtdev *mtdev_new_open(int fd)
 	return NULL;
 }
 
+/*
+ * Type B events are propagated without parsing, straight into the
+ * output queue. A SYN_REPORT is only forwarded if it closes a
+ * non-empty packet.
+ */
 void mtdev_put_event(struct mtdev *dev, const struct input_event *ev)
 {
 	struct mtdev_state *state = dev->state;
-	if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+	if (mtdev_has_mt_event(dev, ABS_MT_SLOT)) {
+		if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+			if (state->outbuf.head == state->synhead)
+				return;
+			evbuf_put(&state->outbuf, ev);
+			state->synhead = state->outbuf.head;
+		} else {
+			evbuf_put(&state->outbuf, ev);
+		}
+	} else if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
 		bitmask_t head = state->outbuf.head;
-		if (mtdev_has_mt_event(dev, ABS_MT_SLOT))
-			process_typeB(state);
-		else
-			convert_A_to_B(state, dev, ev);
+		convert_A_to_B(state, dev, ev);
 		if (state->outbuf.head != head)
 			evbuf_put(&state->outbuf, ev);
 	} else {
@@ -0,0 +1,190 @@
+#include "dist.h"
+#include <stdlib.h>
+
+#if !defined(MTDEV_NO_SIMD) && defined(__SSE2__)
+#define DIST_SSE2
+#include <emmintrin.h>
+#elif !defined(MTDEV_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define DIST_NEON
+#include <arm_neon.h>
+#endif
+
+void mtdev_dist2_matrix_scalar(int *A,
+			       const int *nx, const int *ny, int nn,
+			       const int *sx, const int *sy, int sn)
+{
+	int *row;
+	int i, j;
+
+	for (j = 0; j < sn; j++) {
+		row = A + nn * j;
+		for (i = 0; i < nn; i++)
+			row[i] = dist2(nx[i] - sx[j], ny[i] - sy[j]);
+	}
+}
+
+void mtdev_dist1_matrix_scalar(unsigned int *d,
+			       const struct trk_coord *a, int na,
+			       const struct trk_coord *b, int nb)
+{
+	const struct trk_coord *p, *q;
+
+	for (p = a; p != a + na; p++)
+		for (q = b; q != b + nb; q++)
+			*d++ = abs(q->x - p->x) + abs(q->y - p->y);
+}
+
+#if defined(DIST_SSE2)
+
+const char mtdev_dist_impl[] = "sse2";
+
+/*
+ * The saturating pack and a max against -32767 do clamp15() on eight
+ * deltas at once, madd then squares and sums the interleaved pairs.
+ */
+void mtdev_dist2_matrix(int *A,
+			const int *nx, const int *ny, int nn,
+			const int *sx, const int *sy, int sn)
+{
+	const __m128i lim = _mm_set1_epi16(-32767);
+	__m128i bx, by, dx, dy, t;
+	int *row;
+	int i, j;
+
+	for (j = 0; j < sn; j++) {
+		row = A + nn * j;
+		bx = _mm_set1_epi32(sx[j]);
+		by = _mm_set1_epi32(sy[j]);
+		for (i = 0; i + 8 <= nn; i += 8) {
+			dx = _mm_packs_epi32(
+				_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(nx + i)), bx),
+				_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(nx + i + 4)), bx));
+			dy = _mm_packs_epi32(
+				_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(ny + i)), by),
+				_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(ny + i + 4)), by));
+			dx = _mm_max_epi16(dx, lim);
+			dy = _mm_max_epi16(dy, lim);
+			t = _mm_unpacklo_epi16(dx, dy);
+			_mm_storeu_si128((__m128i *)(row + i), _mm_madd_epi16(t, t));
+			t = _mm_unpackhi_epi16(dx, dy);
+			_mm_storeu_si128((__m128i *)(row + i + 4), _mm_madd_epi16(t, t));
+		}
+		if (i + 4 <= nn) {
+			dx = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(nx + i)), bx);
+			dy = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(ny + i)), by);
+			dx = _mm_max_epi16(_mm_packs_epi32(dx, dx), lim);
+			dy = _mm_max_epi16(_mm_packs_epi32(dy, dy), lim);
+			t = _mm_unpacklo_epi16(dx, dy);
+			_mm_storeu_si128((__m128i *)(row + i), _mm_madd_epi16(t, t));
+			i += 4;
+		}
+		for (; i < nn; i++)
+			row[i] = dist2(nx[i] - sx[j], ny[i] - sy[j]);
+	}
+}
+
+static inline __m128i abs_epi32(__m128i x)
+{
+	__m128i s = _mm_srai_epi32(x, 31);
+	return _mm_sub_epi32(_mm_xor_si128(x, s), s);
+}
+
+void mtdev_dist1_matrix(unsigned int *d,
+			const struct trk_coord *a, int na,
+			const struct trk_coord *b, int nb)
+{
+	const struct trk_coord *p, *q;
+	__m128 d0, d1;
+	__m128i pp;
+	int k;
+
+	for (p = a; p != a + na; p++) {
+		pp = _mm_set_epi32(p->y, p->x, p->y, p->x);
+		for (k = 0; k + 4 <= nb; k += 4) {
+			/* x0 y0 x1 y1, x2 y2 x3 y3 */
+			d0 = _mm_castsi128_ps(abs_epi32(_mm_sub_epi32(
+				_mm_loadu_si128((const __m128i *)(b + k)), pp)));
+			d1 = _mm_castsi128_ps(abs_epi32(_mm_sub_epi32(
+				_mm_loadu_si128((const __m128i *)(b + k + 2)), pp)));
+			_mm_storeu_si128((__m128i *)d, _mm_add_epi32(
+				_mm_castps_si128(_mm_shuffle_ps(d0, d1, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(d0, d1, _MM_SHUFFLE(3, 1, 3, 1)))));
+			d += 4;
+		}
+		for (q = b + k; q != b + nb; q++)
+			*d++ = abs(q->x - p->x) + abs(q->y - p->y);
+	}
+}
+
+#elif defined(DIST_NEON)
+
+const char mtdev_dist_impl[] = "neon";
+
+/* saturating narrow plus a max against -32767 is clamp15() */
+void mtdev_dist2_matrix(int *A,
+			const int *nx, const int *ny, int nn,
+			const int *sx, const int *sy, int sn)
+{
+	const int16x4_t lim = vdup_n_s16(-32767);
+	int32x4_t bx, by, r;
+	int16x4_t dx, dy;
+	int *row;
+	int i, j;
+
+	for (j = 0; j < sn; j++) {
+		row = A + nn * j;
+		bx = vdupq_n_s32(sx[j]);
+		by = vdupq_n_s32(sy[j]);
+		for (i = 0; i + 4 <= nn; i += 4) {
+			dx = vmax_s16(vqmovn_s32(vsubq_s32(vld1q_s32(nx + i), bx)), lim);
+			dy = vmax_s16(vqmovn_s32(vsubq_s32(vld1q_s32(ny + i), by)), lim);
+			r = vmull_s16(dx, dx);
+			r = vmlal_s16(r, dy, dy);
+			vst1q_s32(row + i, r);
+		}
+		for (; i < nn; i++)
+			row[i] = dist2(nx[i] - sx[j], ny[i] - sy[j]);
+	}
+}
+
+void mtdev_dist1_matrix(unsigned int *d,
+			const struct trk_coord *a, int na,
+			const struct trk_coord *b, int nb)
+{
+	const struct trk_coord *p, *q;
+	int32x4x2_t c;
+	int32x4_t r;
+	int k;
+
+	for (p = a; p != a + na; p++) {
+		for (k = 0; k + 4 <= nb; k += 4) {
+			c = vld2q_s32(&b[k].x);
+			r = vabdq_s32(c.val[0], vdupq_n_s32(p->x));
+			r = vaddq_s32(r, vabdq_s32(c.val[1], vdupq_n_s32(p->y)));
+			vst1q_u32(d, vreinterpretq_u32_s32(r));
+			d += 4;
+		}
+		for (q = b + k; q != b + nb; q++)
+			*d++ = abs(q->x - p->x) + abs(q->y - p->y);
+	}
+}
+
+#else
+
+const char mtdev_dist_impl[] = "scalar";
+
+void mtdev_dist2_matrix(int *A,
+			const int *nx, const int *ny, int nn,
+			const int *sx, const int *sy, int sn)
+{
+	mtdev_dist2_matrix_scalar(A, nx, ny, nn, sx, sy, sn);
+}
+
+void mtdev_dist1_matrix(unsigned int *d,
+			const struct trk_coord *a, int na,
+			const struct trk_coord *b, int nb)
+{
+	mtdev_dist1_matrix_scalar(d, a, na, b, nb);
+}
+
+#endif
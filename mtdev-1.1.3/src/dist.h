@@ -0,0 +1,33 @@
+#ifndef MTDEV_DIST_H
+#define MTDEV_DIST_H
+
+/**
+ * Distance matrices for contact matching.
+ *
+ * The kernels are picked at build time: SSE2 on x86, NEON on ARM and
+ * plain C otherwise, or always with MTDEV_NO_SIMD defined. All of them
+ * give the same results as the scalar versions, which stay available
+ * for reference.
+ */
+
+#include "match.h"
+
+extern const char mtdev_dist_impl[];
+
+/* A[j * nn + i] = dist2(n[i] - s[j]), for the hungarian matcher */
+void mtdev_dist2_matrix(int *A,
+			const int *nx, const int *ny, int nn,
+			const int *sx, const int *sy, int sn);
+void mtdev_dist2_matrix_scalar(int *A,
+			       const int *nx, const int *ny, int nn,
+			       const int *sx, const int *sy, int sn);
+
+/* d[i * nb + k] = |b[k].x - a[i].x| + |b[k].y - a[i].y| */
+void mtdev_dist1_matrix(unsigned int *d,
+			const struct trk_coord *a, int na,
+			const struct trk_coord *b, int nb);
+void mtdev_dist1_matrix_scalar(unsigned int *d,
+			       const struct trk_coord *a, int na,
+			       const struct trk_coord *b, int nb);
+
+#endif
@@ -38,25 +38,57 @@ int mtdev_idle(struct mtdev *dev, int fd, int ms)
 	return	buf->head == buf->tail && poll(&fds, 1, ms) <= 0;
 }
 
-int mtdev_fetch_event(struct mtdev *dev, int fd, struct input_event *ev)
+/* read() straight into the free slots following the head */
+static int read_events(struct mtdev_iobuf *buf, int fd)
+{
+	unsigned int pos, room;
+	int n;
+
+	if (buf->head == buf->tail && !buf->partial)
+		buf->head = buf->tail = 0;
+	pos = buf->head & (DIM_EVENTS - 1);
+	room = minval(DIM_EVENTS - (buf->head - buf->tail), DIM_EVENTS - pos);
+	if (!room)
+		return 0;
+	SYSCALL(n = read(fd, (char *)&buf->data[pos] + buf->partial,
+			 room * EVENT_SIZE - buf->partial));
+	if (n <= 0)
+		return n;
+	n += buf->partial;
+	buf->head += n / EVENT_SIZE;
+	buf->partial = n % EVENT_SIZE;
+	return n / EVENT_SIZE;
+}
+
+int mtdev_fetch_span(struct mtdev *dev, int fd, const struct input_event **ev)
 {
 	struct mtdev_iobuf *buf = &dev->state->iobuf;
-	int n = buf->head - buf->tail;
-	if (n < EVENT_SIZE) {
-		if (buf->tail && n > 0)
-			memmove(buf->data, buf->data + buf->tail, n);
-		buf->head = n;
-		buf->tail = 0;
-		SYSCALL(n = read(fd, buf->data + buf->head,
-				 DIM_BUFFER - buf->head));
+	unsigned int pos;
+	int n;
+
+	if (buf->head == buf->tail) {
+		n = read_events(buf, fd);
 		if (n <= 0)
 			return n;
-		buf->head += n;
 	}
-	if (buf->head - buf->tail < EVENT_SIZE)
-		return 0;
-	memcpy(ev, buf->data + buf->tail, EVENT_SIZE);
-	buf->tail += EVENT_SIZE;
+	pos = buf->tail & (DIM_EVENTS - 1);
+	*ev = &buf->data[pos];
+	return minval(buf->head - buf->tail, DIM_EVENTS - pos);
+}
+
+void mtdev_fetch_consume(struct mtdev *dev, int count)
+{
+	dev->state->iobuf.tail += count;
+}
+
+int mtdev_fetch_event(struct mtdev *dev, int fd, struct input_event *ev)
+{
+	const struct input_event *kev;
+	int n = mtdev_fetch_span(dev, fd, &kev);
+	if (n <= 0)
+		return n;
+	*ev = *kev;
+	mtdev_fetch_consume(dev, 1);
 	return 1;
 }
 
@@ -70,18 +102,73 @@ void mtdev_get_event(struct mtdev *dev, struct input_event* ev)
 	evbuf_get(&dev->state->outbuf, ev);
 }
 
+/*
+ * pull_events - convert fetched kernel events up to the end of a frame
+ *
+ * Returns the number of kernel events consumed, or the (non-positive)
+ * result of the fetch.
+ */
+static int pull_events(struct mtdev *dev, int fd)
+{
+	const struct input_event *kev;
+	int i, n;
+
+	n = mtdev_fetch_span(dev, fd, &kev);
+	if (n <= 0)
+		return n;
+	for (i = 0; i < n; i++) {
+		mtdev_put_event(dev, &kev[i]);
+		if (kev[i].type == EV_SYN && kev[i].code == SYN_REPORT &&
+		    !mtdev_empty(dev)) {
+			i++;
+			break;
+		}
+	}
+	mtdev_fetch_consume(dev, i);
+	return i;
+}
+
 int mtdev_get(struct mtdev *dev, int fd, struct input_event* ev, int ev_max)
 {
-	struct input_event kev;
 	int ret, count = 0;
 	while (count < ev_max) {
 		while (mtdev_empty(dev)) {
-			ret = mtdev_fetch_event(dev, fd, &kev);
+			ret = pull_events(dev, fd);
 			if (ret <= 0)
 				return count > 0 ? count : ret;
-			mtdev_put_event(dev, &kev);
 		}
 		mtdev_get_event(dev, &ev[count++]);
 	}
 	return count;
 }
+
+int mtdev_get_span(struct mtdev *dev, int fd, const struct input_event **ev)
+{
+	struct mtdev_evbuf *outbuf = &dev->state->outbuf;
+	int ret;
+
+	/* type B events pass unmodified, hand out the kernel ring itself */
+	if (mtdev_empty(dev) && mtdev_has_mt_event(dev, ABS_MT_SLOT))
+		return mtdev_fetch_span(dev, fd, ev);
+
+	while (mtdev_empty(dev)) {
+		ret = pull_events(dev, fd);
+		if (ret <= 0)
+			return ret;
+	}
+	*ev = &outbuf->buffer[outbuf->tail];
+	if (outbuf->head > outbuf->tail)
+		return outbuf->head - outbuf->tail;
+	return DIM_EVENTS - outbuf->tail;
+}
+
+void mtdev_get_consume(struct mtdev *dev, int count)
+{
+	struct mtdev_evbuf *outbuf = &dev->state->outbuf;
+
+	if (mtdev_empty(dev)) {
+		mtdev_fetch_consume(dev, count);
+		return;
+	}
+	outbuf->tail = (outbuf->tail + count) & (DIM_EVENTS - 1);
+}
@@ -34,9 +34,17 @@
 #define EVENT_SIZE sizeof(struct input_event)
 #define DIM_BUFFER (DIM_EVENTS * EVENT_SIZE)
 
+/*
+ * struct mtdev_iobuf - ring of kernel events, read() lands in place
+ * @head: number of complete events written (free running)
+ * @tail: number of events consumed (free running)
+ * @partial: bytes of an incomplete event at the head slot
+ * @data: the event slots, DIM_EVENTS is a power of two
+ */
 struct mtdev_iobuf {
-	int head, tail;
-	char data[DIM_BUFFER];
+	unsigned int head, tail;
+	int partial;
+	struct input_event data[DIM_EVENTS];
 };
 
 #endif
@@ -388,3 +388,43 @@ void mtdev_match(int ix[DIM_FINGER], int A[DIM2_FINGER], int nrow, int ncol)
 	ixoptimal(ix, A, nrow, ncol);
 }
 
+
+/*
+ * mtdev_match_nearest - assign every row its nearest column
+ *
+ * Succeeds only for a square matrix where each row has a strict
+ * minimum and no two rows share the column of it. That assignment
+ * puts every row at its lower bound, so it is the unique optimum and
+ * exactly what mtdev_match() would return. A is left untouched.
+ *
+ * Returns 1 and fills ix on success, 0 if the optimal matcher is needed.
+ */
+int mtdev_match_nearest(int ix[DIM_FINGER], const int A[DIM2_FINGER],
+			int nrow, int ncol)
+{
+	col_t used = { 0 };
+	int row, col, best, value, minValue, tie;
+
+	if (nrow != ncol)
+		return 0;
+	for (row = 0; row < nrow; row++) {
+		best = 0;
+		minValue = A[row];
+		tie = 0;
+		for (col = 1; col < ncol; col++) {
+			value = A[row + nrow * col];
+			if (value < minValue) {
+				minValue = value;
+				best = col;
+				tie = 0;
+			} else if (value == minValue) {
+				tie = 1;
+			}
+		}
+		if (tie || GET1(used, best))
+			return 0;
+		SET1(used, best);
+		ix[row] = best;
+	}
+	return 1;
+}
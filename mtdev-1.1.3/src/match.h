@@ -39,6 +39,8 @@
 
 void mtdev_match(int index[DIM_FINGER], int A[DIM2_FINGER],
 		 int nrow, int ncol);
+int mtdev_match_nearest(int index[DIM_FINGER], const int A[DIM2_FINGER],
+			int nrow, int ncol);
 
 struct trk_coord {
 	int x;
@@ -1,4 +1,5 @@
 #include "match.h"
+#include "dist.h"
 #include <limits.h>
 
 typedef unsigned char u8;
@@ -68,17 +69,6 @@ static const int match_index[][5] = {
 	{ 790 }
 };
 
-static void set_dist(u32 *dist,
-		     const struct trk_coord *b1, const struct trk_coord *e1,
-		     const struct trk_coord *b2, const struct trk_coord *e2)
-{
-	const struct trk_coord *p, *q;
-
-	for (p = b1; p != e1; p++)
-		for (q = b2; q != e2; q++)
-			*dist++ = abs(q->x - p->x) + abs(q->y - p->y);
-}
-
 const u8 *mtdev_match_four(const struct trk_coord *old, int nslot,
 			   const struct trk_coord *pos, int npos)
 {
@@ -86,7 +76,7 @@ const u8 *mtdev_match_four(const struct trk_coord *old, int nslot,
 	const u8 *p, *b, *e;
 	const int *at;
 
-	set_dist(d, old, old + nslot, pos, pos + npos);
+	mtdev_dist1_matrix(d, old, nslot, pos, npos);
 
 	at = &match_index[nslot][npos];
 	b = &match_data[at[0]];
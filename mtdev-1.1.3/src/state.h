@@ -69,6 +69,7 @@ static inline void set_sval(struct mtdev_slot *slot, int ix, int value)
  * @used: bitmask of currently used slots
  * @slot: slot currently being modified
  * @lastid: last used tracking id
+ * @synhead: outbuf head at the last SYN_REPORT (type B only)
  */
 struct mtdev_state {
 
@@ -83,6 +84,7 @@ struct mtdev_state {
 	bitmask_t used;
 	bitmask_t slot;
 	bitmask_t lastid;
+	int synhead;
 };
 
 #endif
@@ -0,0 +1,175 @@
+/*
+ * Gesture engine.
+ *
+ * Input events (as delivered by mtdev, type B) are framed per slot and
+ * handed to a recognizer backend (see recognizer.h) at every SYN_REPORT.
+ * Shared by the daemon and the offline tools.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "frame.h"
+#include "gesture.h"
+#include "latency.h"
+#include "recognizer.h"
+
+static const struct recognizer *const mRecognizers[] = {
+	&native_recognizer,
+	&grail_recognizer,
+	NULL
+};
+
+struct engine {
+	struct uinput_api	*ua;
+	struct utouch_frame	*frame;
+	const struct recognizer	*rec;
+	void				*rec_data;
+
+	/* latency accounting, see engine_set_timing() */
+	int					timing;
+	clockid_t			clock;
+	struct lat_hist		lat_e2e;	/* kernel SYN_REPORT to uinput write,
+									   or to the ring of a writer thread */
+	struct lat_hist		lat_sync;	/* frame_sync() alone */
+};
+
+/* debug switch */
+int event_debug_print = 0;
+
+static void print_event(struct engine *eng, const struct input_event *ev)
+{
+	if (event_debug_print == 0)
+		return;
+	static const utouch_frame_time_t ms = 1000;
+	static int slot = 0;
+	utouch_frame_time_t evtime = ev->time.tv_usec / ms + ev->time.tv_sec * ms;
+	if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT)
+		slot = ev->value;
+	fprintf(stderr, "%012llx %02d(%02d) %01d %04x %d\n",
+		evtime, slot, eng->frame->current_slot, ev->type, ev->code, ev->value);
+}
+
+static void timed_sync(struct engine *eng, const struct input_event *syn)
+{
+	uint64_t t0, t1, t2, tk;
+
+	t0 = lat_now(eng->clock);
+	eng->rec->sync(eng->rec_data, eng->ua, eng->frame, syn);
+	t1 = lat_now(eng->clock);
+	uinput_flush(eng->ua);
+	t2 = lat_now(eng->clock);
+
+	tk = (uint64_t)syn->time.tv_sec * 1000000000 + syn->time.tv_usec * 1000;
+	lat_hist_add(&eng->lat_sync, t1 - t0);
+	lat_hist_add(&eng->lat_e2e, t2 > tk ? t2 - tk : 0);
+}
+
+/* input event handler */
+void engine_event(struct engine *eng, const struct input_event *ev)
+{
+	print_event(eng, ev);
+
+	if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+		frame_set_evtime(eng->frame, ev);
+		eng->ua->time = ev->time;	/* output in input time */
+		if (eng->timing) {
+			timed_sync(eng, ev);
+		} else {
+			eng->rec->sync(eng->rec_data, eng->ua, eng->frame, ev);
+			uinput_flush(eng->ua);
+		}
+		return;
+	}
+	if (eng->rec->event)
+		eng->rec->event(eng->rec_data, ev);
+	if (ev->type == EV_ABS)
+		frame_abs_event(eng->frame, ev);
+}
+
+const struct recognizer *engine_find_recognizer(const char *name)
+{
+	int i;
+
+	for (i = 0; mRecognizers[i]; i++)
+		if (strcmp(mRecognizers[i]->name, name) == 0)
+			return mRecognizers[i];
+	return NULL;
+}
+
+int engine_early_flick(const struct recognizer *rec)
+{
+	return (rec ? rec : &native_recognizer)->early_flick;
+}
+
+const char *engine_recognizer_name(int i)
+{
+	if (i < 0 || i >= (int)(sizeof(mRecognizers) / sizeof(mRecognizers[0])) - 1)
+		return NULL;
+	return mRecognizers[i]->name;
+}
+
+struct engine *engine_new(struct uinput_api *ua,
+						  const struct gesture_param *param,
+						  const struct recognizer *rec)
+{
+	struct engine *eng;
+
+	eng = calloc(1, sizeof(*eng));
+	if (!eng)
+		return NULL;
+	eng->rec = rec ? rec : &native_recognizer;
+	eng->frame = create_frame(param->max_touch);
+	if (eng->frame)
+		eng->rec_data = eng->rec->create(param);
+	if (!eng->rec_data) {
+		destroy_frame(eng->frame);
+		free(eng);
+		return NULL;
+	}
+	eng->ua = ua;
+	return eng;
+}
+
+/*
+ * Switch to another parameter block. Parameters are only consulted at
+ * SYN_REPORT, so calling this from the event loop takes effect between
+ * two frames.
+ */
+void engine_set_param(struct engine *eng, const struct gesture_param *param)
+{
+	eng->rec->set_param(eng->rec_data, param);
+}
+
+void engine_set_timing(struct engine *eng, clockid_t clock)
+{
+	eng->timing = 1;
+	eng->clock = clock;
+	/* a writer thread accounts the writes itself */
+	if (uinput_set_timing(eng->ua, clock))
+		lat_hist_init(&eng->lat_e2e, "queued");
+	else
+		lat_hist_init(&eng->lat_e2e, "e2e");
+	lat_hist_init(&eng->lat_sync, "sync");
+}
+
+void engine_print_stats(struct engine *eng, FILE *fp)
+{
+	if (!eng->timing)
+		return;
+	lat_hist_print(&eng->lat_e2e, fp);
+	lat_hist_print(&eng->lat_sync, fp);
+	uinput_print_stats(eng->ua, fp);
+}
+
+void engine_delete(struct engine *eng)
+{
+	if (eng) {
+		eng->rec->destroy(eng->rec_data);
+		destroy_frame(eng->frame);
+		free(eng);
+	}
+}
+/* EOF */
@@ -0,0 +1,234 @@
+/*
+ * Grail recognizer backend.
+ *
+ * Pointer output comes from the engine frame as with the native backend;
+ * the gestures come from utouch-grail, fed the same type B events. One
+ * finger drags that end within the flick thresholds report a flick,
+ * two or more finger pinches report like the native pinch. Grail taps
+ * and rotations have no id in the output protocol and are not
+ * subscribed. Flicks are only known at touch-up, flick_early is not
+ * supported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "grail.h"
+#include "recognizer.h"
+#include "gesture.h"
+
+/* debug switch */
+int grail_debug_print = 0;
+
+struct grail_rec {
+	struct grail		ge;
+	struct gesture_ctx	ctx;		/* touch output, flick thresholds */
+	struct uinput_api	*ua;		/* set during grail_pump() */
+
+	/* one finger stroke, from touch-down */
+	utouch_frame_time_t	down_time;
+	float				down_x, down_y;
+	int					drag;
+	float				drag_x, drag_y;		/* last drag position */
+	float				drag_vx, drag_vy;	/* units/ms */
+
+	/* pinch spread (mm) and radius at the last report */
+	int					pinch;
+	float				pinch_w, pinch_h, pinch_r;
+};
+
+/* a single client, listening to what the output can carry */
+static int gr_clients(struct grail *ge,
+					  struct grail_client_info *client, int max_clients,
+					  const struct grail_coord *coords, int num_coords,
+					  const grail_mask_t *types, int type_bytes)
+{
+	if (max_clients < 1)
+		return 0;
+	memset(client, 0, sizeof(*client));
+	grail_mask_set(client->mask, GRAIL_TYPE_DRAG1);
+	grail_mask_set(client->mask, GRAIL_TYPE_PINCH2);
+	grail_mask_set(client->mask, GRAIL_TYPE_PINCH3);
+	grail_mask_set(client->mask, GRAIL_TYPE_PINCH4);
+	grail_mask_set(client->mask, GRAIL_TYPE_PINCH5);
+	return 1;
+}
+
+static void gr_drag(struct grail_rec *gr, const struct grail_event *gev)
+{
+	const struct gesture_param *gp = gr->ctx.param;
+	const grail_prop_t *p = gev->prop;
+
+	if (gev->status != GRAIL_STATUS_END) {
+		gr->drag = 1;
+		gr->drag_x = p[GRAIL_PROP_DRAG_X];
+		gr->drag_y = p[GRAIL_PROP_DRAG_Y];
+		gr->drag_vx = p[GRAIL_PROP_DRAG_VX];
+		gr->drag_vy = p[GRAIL_PROP_DRAG_VY];
+		return;
+	}
+	if (!gr->drag)
+		return;
+	gr->drag = 0;
+	flick_stroke(&gr->ctx, gr->ua,
+				 (gr->drag_x - gr->down_x) / gp->scale_ppm_x,
+				 (gr->drag_y - gr->down_y) / gp->scale_ppm_y,
+				 gr->drag_vx / gp->scale_ppm_x,
+				 gr->drag_vy / gp->scale_ppm_y,
+				 gev->time - gr->down_time);
+}
+
+/* same rule as pinch_check() and pinch_event() */
+static void gr_pinch(struct grail_rec *gr, const struct grail_event *gev)
+{
+	const struct gesture_param *gp = gr->ctx.param;
+	const grail_prop_t *p = gev->prop;
+	struct uinput_api *ua = gr->ua;
+	float w, h, r;
+
+	if (gev->status == GRAIL_STATUS_END) {
+		gr->pinch = 0;
+		return;
+	}
+	w = fabsf(p[GRAIL_PROP_PINCH_X2] - p[GRAIL_PROP_PINCH_X1]) /
+		gp->scale_ppm_x;
+	h = fabsf(p[GRAIL_PROP_PINCH_Y2] - p[GRAIL_PROP_PINCH_Y1]) /
+		gp->scale_ppm_y;
+	r = p[GRAIL_PROP_PINCH_R];
+	if (gr->pinch &&
+		fabsf(w - gr->pinch_w) < gp->pinch_dist_min_threshold &&
+		fabsf(h - gr->pinch_h) < gp->pinch_dist_min_threshold)
+		return;
+	if (gr->pinch) {
+		ua->gestureId = r >= gr->pinch_r ? PINCH_ID_IN : PINCH_ID_OUT;
+		ua->valuators[0] = (u_int16_t)w;
+		ua->valuators[1] = (u_int16_t)h;
+		ua->valuators[2] = 0;
+		uinput_Gesture(ua);
+	}
+	gr->pinch = 1;
+	gr->pinch_w = w;
+	gr->pinch_h = h;
+	gr->pinch_r = r;
+}
+
+static void gr_gesture(struct grail *ge, const struct grail_event *gev)
+{
+	struct grail_rec *gr = ge->priv;
+
+	if (grail_debug_print == 1)
+	fprintf(stdout, "%s() - type %d, id %d, status %d, touches %d, "
+			"time %llu\n", __func__, gev->type, gev->id, gev->status,
+			gev->ntouch, (unsigned long long)gev->time);
+	switch (gev->type) {
+	case GRAIL_TYPE_DRAG1:
+		gr_drag(gr, gev);
+		break;
+	case GRAIL_TYPE_PINCH2:
+	case GRAIL_TYPE_PINCH3:
+	case GRAIL_TYPE_PINCH4:
+	case GRAIL_TYPE_PINCH5:
+		gr_pinch(gr, gev);
+		break;
+	}
+}
+
+static void *gr_create(const struct gesture_param *param)
+{
+	struct grail_rec *gr;
+	struct grail_coord min = { 0, 0 }, max, box;
+
+	gr = calloc(1, sizeof(*gr));
+	if (!gr)
+		return NULL;
+	gesture_ctx_init(&gr->ctx, param);
+	gr->ge.get_clients = gr_clients;
+	gr->ge.gesture = gr_gesture;
+	gr->ge.priv = gr;
+	max.x = param->device_xres;
+	max.y = param->device_yres;
+	box.x = param->phys_xsize;
+	box.y = param->phys_ysize;
+	if (grail_open_surface(&gr->ge, &min, &max, &box) < 0) {
+		fprintf(stderr, "error: could not open grail\n");
+		free(gr);
+		return NULL;
+	}
+	return gr;
+}
+
+static void gr_destroy(void *rec)
+{
+	struct grail_rec *gr = rec;
+
+	if (gr) {
+		grail_close(&gr->ge, -1);
+		free(gr);
+	}
+}
+
+static void gr_set_param(void *rec, const struct gesture_param *param)
+{
+	struct grail_rec *gr = rec;
+
+	gr->ctx.param = param;
+}
+
+static void gr_event(void *rec, const struct input_event *ev)
+{
+	struct grail_rec *gr = rec;
+
+	grail_pump(&gr->ge, ev);
+}
+
+static void gr_sync(void *rec, struct uinput_api *ua,
+					struct utouch_frame *f, const struct input_event *syn)
+{
+	struct grail_rec *gr = rec;
+	struct gesture_ctx *ctx = &gr->ctx;
+	struct utouch_contact *t;
+	uint32_t mask;
+	int i;
+
+	for (mask = f->active_mask; mask; mask &= mask - 1) {
+		i = __builtin_ctz(mask);
+		frame_set_active_slot(f, i);
+		switch (frame_get_slot_status(f)) {
+		case FRAME_STATUS_BEGIN:
+			if (frame_active_nslot(f) == 1) {
+				t = frame_get_slot(f);
+				gr->down_time = f->time;
+				gr->down_x = t->x;
+				gr->down_y = t->y;
+			}
+			motion_begin(ctx, f);
+			touch_down_event(ctx, ua, f);
+			frame_set_slot_status(f, FRAME_STATUS_UPDATE);
+			break;
+		case FRAME_STATUS_UPDATE:
+			motion_update(ctx, f);
+			touch_move_event(ctx, ua, f);
+			break;
+		case FRAME_STATUS_END:
+			touch_up_event(ctx, ua, f);
+			frame_set_slot_inactive(f);
+			break;
+		}
+	}
+
+	gr->ua = ua;
+	grail_pump(&gr->ge, syn);
+	gr->ua = NULL;
+}
+
+const struct recognizer grail_recognizer = {
+	.name		= "grail",
+	.create		= gr_create,
+	.destroy	= gr_destroy,
+	.set_param	= gr_set_param,
+	.event		= gr_event,
+	.sync		= gr_sync,
+};
+/* EOF */
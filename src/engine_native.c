@@ -0,0 +1,98 @@
+/*
+ * Native recognizer backend: the touch, flick and pinch recognizers of
+ * src/gesture_*.c, run per active contact in slot order.
+ */
+
+#include <stdlib.h>
+
+#include "recognizer.h"
+#include "gesture.h"
+
+static void *native_create(const struct gesture_param *param)
+{
+	struct gesture_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx)
+		gesture_ctx_init(ctx, param);
+	return ctx;
+}
+
+static void native_destroy(void *rec)
+{
+	free(rec);
+}
+
+static void native_set_param(void *rec, const struct gesture_param *param)
+{
+	struct gesture_ctx *ctx = rec;
+
+	ctx->param = param;
+}
+
+/* Gesture recognizer */
+static void native_sync(void *rec, struct uinput_api *ua,
+						struct utouch_frame *f, const struct input_event *syn)
+{
+	struct gesture_ctx *ctx = rec;
+	uint32_t mask;
+	int i;
+	int num_active;
+
+	num_active = frame_active_nslot(f);
+
+	/* visit active contacts only, in slot order */
+	for (mask = f->active_mask; mask; mask &= mask - 1) {
+		i = __builtin_ctz(mask);
+		frame_set_active_slot(f, i);
+		switch (frame_get_slot_status(f)) {
+		case FRAME_STATUS_BEGIN:
+			if (num_active > 1)
+				ctx->multi_touch = 1;
+			else
+				ctx->multi_touch = 0;
+			if (!ctx->multi_touch)
+				flick_reset(ctx, f);
+			motion_begin(ctx, f);
+			touch_down_event(ctx, ua, f);
+			frame_set_slot_status(f, FRAME_STATUS_UPDATE);
+			if (ctx->multi_touch)
+				pinch_reset(ctx, f);
+			break;
+		case FRAME_STATUS_UPDATE:
+			motion_update(ctx, f);
+			touch_move_event(ctx, ua, f);
+			if (ctx->multi_touch && pinch_check(ctx, f)) {
+				pinch_event(ctx, ua, f);
+			}
+			if (!ctx->multi_touch) {
+				flick_update(ctx, f);
+				if (ctx->param->flick_early &&
+					flick_commit_check(ctx, f))
+					flick_event(ctx, ua, f);
+			}
+			break;
+		case FRAME_STATUS_END:
+			if (ctx->flick.committed &&
+				ctx->flick.committed_slot == i) {
+				flick_release(ctx, ua, f);
+			} else if (!ctx->multi_touch && flick_check(ctx, f)) {
+				flick_event(ctx, ua, f);
+			}
+			touch_up_event(ctx, ua, f);
+			frame_set_slot_inactive(f);
+			break;
+		}
+	}
+}
+
+const struct recognizer native_recognizer = {
+	.name		= "native",
+	.create		= native_create,
+	.destroy	= native_destroy,
+	.set_param	= native_set_param,
+	.event		= NULL,
+	.sync		= native_sync,
+	.early_flick	= 1,
+};
+/* EOF */
@@ -0,0 +1,188 @@
+/*
+ * epoll based event loop.
+ *
+ * File descriptors (input devices, timers, sockets) are registered with
+ * a callback, signals are delivered through a signalfd so that they are
+ * handled synchronously between two callbacks. The loop sleeps without
+ * timeout until one of the sources becomes ready.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+
+#include "evloop.h"
+
+struct evloop_source {
+	int				fd;
+	evloop_fd_cb	cb;
+	void			*data;
+};
+
+struct evloop_signal {
+	evloop_sig_cb	cb;
+	void			*data;
+};
+
+struct evloop {
+	int				epfd;
+	int				sigfd;
+	int				running;
+	sigset_t		sigmask;
+	struct evloop_source	src[EVLOOP_DIM_SOURCES];
+	struct evloop_signal	sig[_NSIG];
+};
+
+static struct evloop_source *find_source(struct evloop *loop, int fd)
+{
+	int i;
+
+	for (i = 0; i < EVLOOP_DIM_SOURCES; i++)
+		if (loop->src[i].cb && loop->src[i].fd == fd)
+			return &loop->src[i];
+	return NULL;
+}
+
+static void on_signalfd(struct evloop *loop, int fd, uint32_t events,
+						void *data)
+{
+	struct signalfd_siginfo si;
+	struct evloop_signal *s;
+
+	while (read(fd, &si, sizeof(si)) == sizeof(si)) {
+		if (si.ssi_signo >= _NSIG)
+			continue;
+		s = &loop->sig[si.ssi_signo];
+		if (s->cb)
+			s->cb(loop, si.ssi_signo, s->data);
+	}
+}
+
+struct evloop *evloop_new()
+{
+	struct evloop *loop;
+
+	loop = calloc(1, sizeof(*loop));
+	if (!loop)
+		return NULL;
+	loop->sigfd = -1;
+	sigemptyset(&loop->sigmask);
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0) {
+		perror("evloop_new: epoll_create1");
+		free(loop);
+		return NULL;
+	}
+	return loop;
+}
+
+void evloop_destroy(struct evloop *loop)
+{
+	if (loop) {
+		if (loop->sigfd >= 0) {
+			close(loop->sigfd);
+			sigprocmask(SIG_UNBLOCK, &loop->sigmask, NULL);
+		}
+		close(loop->epfd);
+		free(loop);
+	}
+}
+
+int evloop_add(struct evloop *loop, int fd, evloop_fd_cb cb, void *data)
+{
+	struct evloop_source *s;
+	struct epoll_event ev;
+
+	if (find_source(loop, fd))
+		return -EEXIST;
+	for (s = loop->src; s < loop->src + EVLOOP_DIM_SOURCES; s++)
+		if (!s->cb)
+			break;
+	if (s == loop->src + EVLOOP_DIM_SOURCES)
+		return -ENOSPC;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = s;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		perror("evloop_add: epoll_ctl");
+		return -errno;
+	}
+	s->fd = fd;
+	s->cb = cb;
+	s->data = data;
+	return 0;
+}
+
+int evloop_del(struct evloop *loop, int fd)
+{
+	struct evloop_source *s = find_source(loop, fd);
+
+	if (!s)
+		return -ENOENT;
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+	memset(s, 0, sizeof(*s));
+	return 0;
+}
+
+int evloop_signal(struct evloop *loop, int signo, evloop_sig_cb cb, void *data)
+{
+	int fd;
+
+	if (signo <= 0 || signo >= _NSIG)
+		return -EINVAL;
+	sigaddset(&loop->sigmask, signo);
+	if (sigprocmask(SIG_BLOCK, &loop->sigmask, NULL) < 0) {
+		perror("evloop_signal: sigprocmask");
+		return -errno;
+	}
+	fd = signalfd(loop->sigfd, &loop->sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		perror("evloop_signal: signalfd");
+		return -errno;
+	}
+	if (loop->sigfd < 0) {
+		loop->sigfd = fd;
+		if (evloop_add(loop, fd, on_signalfd, NULL) < 0)
+			return -EINVAL;
+	}
+	loop->sig[signo].cb = cb;
+	loop->sig[signo].data = data;
+	return 0;
+}
+
+int evloop_run(struct evloop *loop)
+{
+	struct epoll_event evs[EVLOOP_DIM_SOURCES];
+	struct evloop_source *s;
+	int i, n;
+
+	loop->running = 1;
+	while (loop->running) {
+		n = epoll_wait(loop->epfd, evs, EVLOOP_DIM_SOURCES, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("evloop_run: epoll_wait");
+			return -errno;
+		}
+		for (i = 0; i < n && loop->running; i++) {
+			s = evs[i].data.ptr;
+			if (s->cb)
+				s->cb(loop, s->fd, evs[i].events, s->data);
+		}
+	}
+	return 0;
+}
+
+void evloop_quit(struct evloop *loop)
+{
+	loop->running = 0;
+}
+/* EOF */
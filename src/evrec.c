@@ -0,0 +1,286 @@
+/*
+ * Binary input event recordings.
+ *
+ * A compact alternative to the evemu text format: events are delta and
+ * varint encoded, typically 5 bytes each instead of ~30 characters, and
+ * an index of frame offsets lets a reader mmap the file and start at any
+ * frame. See evrec.h for the layout.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "evrec.h"
+
+#define EVREC_DIM_INDEX	1024
+
+static void put_le(unsigned char *p, uint64_t v, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++, v >>= 8)
+		p[i] = v & 0xff;
+}
+
+static uint64_t get_le(const unsigned char *p, int n)
+{
+	uint64_t v = 0;
+
+	while (n--)
+		v = (v << 8) | p[n];
+	return v;
+}
+
+static int put_varint(unsigned char *p, uint64_t v)
+{
+	int n = 0;
+
+	while (v >= 0x80) {
+		p[n++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	p[n++] = v;
+	return n;
+}
+
+static const unsigned char *get_varint(const unsigned char *p,
+									   const unsigned char *end, uint64_t *v)
+{
+	int shift = 0;
+
+	*v = 0;
+	while (p < end && shift < 64) {
+		*v |= (uint64_t)(*p & 0x7f) << shift;
+		if (!(*p++ & 0x80))
+			return p;
+		shift += 7;
+	}
+	return NULL;	/* truncated */
+}
+
+static uint64_t zigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint64_t event_time(const struct input_event *ev)
+{
+	return (uint64_t)ev->time.tv_sec * 1000000 + ev->time.tv_usec;
+}
+
+static void write_header(struct evrec_writer *w, unsigned char *hdr,
+						 uint64_t index_offset)
+{
+	memset(hdr, 0, EVREC_HEADER_SIZE);
+	memcpy(hdr, EVREC_MAGIC, sizeof(EVREC_MAGIC));
+	put_le(hdr + 8, EVREC_VERSION, 4);
+	put_le(hdr + 12, w->desc_len, 4);
+	put_le(hdr + 16, w->nevents, 4);
+	put_le(hdr + 20, w->nframes, 4);
+	put_le(hdr + 24, index_offset, 8);
+}
+
+/* fp must be seekable, the header is completed by evrec_write_end() */
+int evrec_write_begin(struct evrec_writer *w, FILE *fp,
+					  const char *desc, uint32_t desc_len)
+{
+	unsigned char hdr[EVREC_HEADER_SIZE];
+
+	memset(w, 0, sizeof(*w));
+	w->fp = fp;
+	w->desc_len = desc ? desc_len : 0;
+	w->index_size = EVREC_DIM_INDEX;
+	w->index = malloc(2 * w->index_size * sizeof(w->index[0]));
+	if (!w->index)
+		return -1;
+	write_header(w, hdr, 0);
+	if (fwrite(hdr, sizeof(hdr), 1, fp) != 1)
+		return -1;
+	if (w->desc_len && fwrite(desc, w->desc_len, 1, fp) != 1)
+		return -1;
+	w->offset = EVREC_HEADER_SIZE + w->desc_len;
+	return 0;
+}
+
+int evrec_write_event(struct evrec_writer *w, const struct input_event *ev)
+{
+	unsigned char buf[32];
+	uint64_t t = event_time(ev), *p;
+	int n;
+
+	if (!w->frame_open) {
+		if (w->nframes == w->index_size) {
+			p = realloc(w->index, 4 * w->index_size * sizeof(*p));
+			if (!p)
+				return -1;
+			w->index = p;
+			w->index_size *= 2;
+		}
+		w->index[2 * w->nframes] = w->offset;
+		w->index[2 * w->nframes + 1] = w->time;
+		w->frame_open = 1;
+	}
+
+	n = put_varint(buf, zigzag((int64_t)(t - w->time)));
+	buf[n++] = ev->type;
+	n += put_varint(buf + n, ev->code);
+	n += put_varint(buf + n, zigzag(ev->value));
+	if (fwrite(buf, n, 1, w->fp) != 1)
+		return -1;
+
+	w->offset += n;
+	w->time = t;
+	w->nevents++;
+	if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+		w->nframes++;
+		w->frame_open = 0;
+	}
+	return 0;
+}
+
+int evrec_write_end(struct evrec_writer *w)
+{
+	unsigned char buf[16], hdr[EVREC_HEADER_SIZE];
+	uint32_t i;
+	int ret = -1;
+
+	for (i = 0; i < w->nframes; i++) {
+		put_le(buf, w->index[2 * i], 8);
+		put_le(buf + 8, w->index[2 * i + 1], 8);
+		if (fwrite(buf, sizeof(buf), 1, w->fp) != 1)
+			goto out;
+	}
+	write_header(w, hdr, w->offset);
+	if (fseek(w->fp, 0, SEEK_SET) < 0 ||
+		fwrite(hdr, sizeof(hdr), 1, w->fp) != 1 ||
+		fflush(w->fp) != 0)
+		goto out;
+	ret = 0;
+out:
+	free(w->index);
+	w->index = NULL;
+	return ret;
+}
+
+/* 1 if path holds a binary recording */
+int evrec_probe(const char *path)
+{
+	char magic[sizeof(EVREC_MAGIC)];
+	int fd, ret = 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	if (read(fd, magic, sizeof(magic)) == sizeof(magic))
+		ret = memcmp(magic, EVREC_MAGIC, sizeof(magic)) == 0;
+	close(fd);
+	return ret;
+}
+
+struct evrec *evrec_open(const char *path)
+{
+	struct evrec *r;
+	struct stat st;
+	uint64_t index_offset;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size < EVREC_HEADER_SIZE) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	r = calloc(1, sizeof(*r));
+	if (!r)
+		goto err;
+	r->map = map;
+	r->size = st.st_size;
+	if (memcmp(r->map, EVREC_MAGIC, sizeof(EVREC_MAGIC)) ||
+		get_le(r->map + 8, 4) != EVREC_VERSION)
+		goto err;
+	r->desc_len = get_le(r->map + 12, 4);
+	r->nevents = get_le(r->map + 16, 4);
+	r->nframes = get_le(r->map + 20, 4);
+	index_offset = get_le(r->map + 24, 8);
+	if (index_offset < EVREC_HEADER_SIZE + (uint64_t)r->desc_len ||
+		index_offset + 16 * (uint64_t)r->nframes > r->size)
+		goto err;
+	r->desc = r->desc_len ? (const char *)r->map + EVREC_HEADER_SIZE : NULL;
+	r->index = r->map + index_offset;
+	r->end = r->index;
+	r->pos = r->map + EVREC_HEADER_SIZE + r->desc_len;
+	r->time = 0;
+	return r;
+err:
+	free(r);
+	munmap(map, st.st_size);
+	return NULL;
+}
+
+void evrec_close(struct evrec *r)
+{
+	if (r) {
+		munmap((void *)r->map, r->size);
+		free(r);
+	}
+}
+
+/* position the cursor at the first event of a frame */
+int evrec_seek(struct evrec *r, uint32_t frame)
+{
+	const unsigned char *ix;
+	uint64_t offset;
+
+	if (frame >= r->nframes)
+		return -1;
+	ix = r->index + 16 * frame;
+	offset = get_le(ix, 8);
+	if (offset >= r->index - r->map)
+		return -1;
+	r->pos = r->map + offset;
+	r->time = get_le(ix + 8, 8);
+	return 0;
+}
+
+/* 1 on event, 0 at the end, -1 on a corrupt stream */
+int evrec_read(struct evrec *r, struct input_event *ev)
+{
+	const unsigned char *p = r->pos;
+	uint64_t dt, code, value;
+
+	if (p == r->end)
+		return 0;
+	p = get_varint(p, r->end, &dt);
+	if (!p || p == r->end)
+		return -1;
+	ev->type = *p++;
+	p = get_varint(p, r->end, &code);
+	if (p)
+		p = get_varint(p, r->end, &value);
+	if (!p)
+		return -1;
+	r->time += unzigzag(dt);
+	ev->time.tv_sec = r->time / 1000000;
+	ev->time.tv_usec = r->time % 1000000;
+	ev->code = code;
+	ev->value = unzigzag(value);
+	r->pos = p;
+	return 1;
+}
+/* EOF */
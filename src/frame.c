@@ -7,21 +7,9 @@
 #include "mtdev.h"
 #include "frame.h"
 
-static void destroy_slots(struct utouch_contact **slots, int nslot)
+static struct utouch_contact *create_slots(int nslot)
 {
-	int i;
-
-	if (slots) {
-		for (i = nslot - 1; i >= 0; i--)
-			free(slots[i]);
-		free(slots);
-	}
-}
-
-static struct utouch_contact **create_slots(int nslot, int size)
-{
-	struct utouch_contact **slots;
-	struct utouch_contact *s;
+	struct utouch_contact *slots;
 	int i;
 
 	slots = calloc(nslot, sizeof(slots[0]));
@@ -29,70 +17,54 @@ static struct utouch_contact **create_slots(int nslot, int size)
 		return 0;
 
 	for (i = 0; i < nslot; i++) {
-		s = calloc(1, size);
-		if (!s)
-			goto out;
-		slots[i] = s;
-		s->slot = i;
-		s->active = -1;
-		s->id = -1;
+		slots[i].slot = i;
+		slots[i].active = -1;
+		slots[i].id = -1;
 	}
 
 	return slots;
-out:
-	destroy_slots(slots, nslot);
-	return 0;
 }
 
 int frame_active_nslot(struct utouch_frame *frame)
 {
-	int i;
-	struct utouch_contact *t;
-
-	frame->num_active = 0;
-	for (i = 0; i < frame->num_slots; i++) {
-		t = frame->slots[i];
-		if (t->active == -1) continue;
-			frame->num_active++;
-	}
+	frame->num_active = __builtin_popcount(frame->active_mask);
 	return frame->num_active;
 }
 
 int frame_set_active_slot(struct utouch_frame *frame, int slot)
 {
-	struct utouch_contact *t;
 	frame->slot_revision = slot;
-	t = frame->slots[frame->slot_revision];
-	if (t->active == -1)
+	if (frame->slots[slot].active == -1)
 		return 0;	/* inactive */
 	return 1;		/* active */
 }
 
 int frame_get_slot_status(struct utouch_frame *frame)
 {
-	return frame->slots[frame->slot_revision]->active;
+	return frame->slots[frame->slot_revision].active;
 }
 
 void frame_set_slot_status(struct utouch_frame *frame, int status)
 {
-	frame->slots[frame->slot_revision]->active = status;
+	frame->slots[frame->slot_revision].active = status;
 }
 
 void frame_set_slot_inactive(struct utouch_frame *frame)
 {
-	frame->slots[frame->slot_revision]->active = -1;
-	frame->slots[frame->slot_revision]->id = -1;
+	frame->slots[frame->slot_revision].active = -1;
+	frame->slots[frame->slot_revision].id = -1;
+	frame->active_mask &= ~(1u << frame->slot_revision);
 }
 
 struct utouch_contact *frame_get_slot(struct utouch_frame *frame)
 {
-	return frame->slots[frame->slot_revision];
+	return &frame->slots[frame->slot_revision];
 }
 
-void destroy_frame(struct utouch_frame *frame, int nslot)
+void destroy_frame(struct utouch_frame *frame)
 {
 	if (frame) {
-		destroy_slots(frame->slots, nslot);
+		free(frame->slots);
 		free(frame);
 	}
 }
@@ -101,11 +73,13 @@ struct utouch_frame *create_frame(int nslot)
 {
 	struct utouch_frame *frame;
 
+	if (nslot < 1 || nslot > FRAME_MAX_SLOTS)
+		return 0;
 	frame = calloc(1, sizeof(struct utouch_frame));
 	if (!frame)
 		return 0;
 
-	frame->slots = create_slots(nslot, sizeof(struct utouch_contact));
+	frame->slots = create_slots(nslot);
 	if (!frame->slots)
 		goto out;
 	frame->num_slots = nslot;
@@ -114,7 +88,7 @@ struct utouch_frame *create_frame(int nslot)
 
 	return frame;
 out:
-	destroy_frame(frame, nslot);
+	destroy_frame(frame);
 	return 0;
 }
 
@@ -133,14 +107,23 @@ utouch_frame_time_t frame_set_evtime(
 
 int frame_abs_event(struct utouch_frame *frame, const struct input_event *ev)
 {
-	struct utouch_contact *t = frame->slots[frame->current_slot];
+	struct utouch_contact *t;
 
-	switch (ev->code) {
-	case ABS_MT_SLOT:
-		if (ev->value < frame->num_slots)
+	if (ev->code == ABS_MT_SLOT) {
+		/* contacts past num_slots are dropped, not merged */
+		if (ev->value >= 0 && ev->value < frame->num_slots)
 			frame->current_slot = ev->value;
+		else
+			frame->current_slot = frame->num_slots;
 		return 1;
+	}
+	if (frame->current_slot >= frame->num_slots)
+		return 0;
+	t = &frame->slots[frame->current_slot];
+
+	switch (ev->code) {
 	case ABS_MT_TRACKING_ID:
+		frame->active_mask |= 1u << frame->current_slot;
 		if (ev->value == -1) {
 			t->active = FRAME_STATUS_END;
 		} else {
@@ -11,194 +11,366 @@
 /* debug switch */
 extern int flick_debug_print;
 
-extern float m_scale_ppm_x; /* Unit of mm */
-extern float m_scale_ppm_y; /* Unit of mm */
+/* sector boundaries of the 8 direction layout */
+static const gnum_t tan_30 = GNUM_CONST(0.57735027);
+static const gnum_t tan_60 = GNUM_CONST(1.7320508);
 
-extern float flick_dist_min_threshold;
-extern float flick_dist_max_threshold;
-extern float flick_velo_min_threshold;
-extern float flick_time_min_threshold;
-extern float flick_time_max_threshold;
-
-static const float radian_30 = 30 * M_PI / 180;
-static const float radian_45 = 45 * M_PI / 180;
-static const float radian_60 = 60 * M_PI / 180;
-static const float radian_90 = 90 * M_PI / 180;
-static int flick_dir = 4;
-
-static utouch_frame_time_t mFlickStartTime = 0;
-static float mFlickPos_x = 0.0;
-static float mFlickPos_y = 0.0;
-static float mFlickDistance[DIM_FM];
-static float mFlickVelocity[DIM_FM];
+void flick_init(struct gesture_ctx *ctx)
+{
+	flick_reset(ctx, NULL);
+}
 
-void flick_init()
+/* boundary component, exactly 0 on the axes so both builds agree */
+static gnum_t sector_coord(float c)
 {
-	flick_reset(NULL);
+	return fabsf(c) < 1e-6 ? 0 : gnum_from_float(c);
 }
 
-void flick_set_dir_div(int d)
+/* also lays out the sector boundaries, at (2k + 1) * 180 / d degrees */
+int flick_set_dir_div(struct gesture_param *param, int d)
 {
-	if (d == 4 || d == 8)
-		flick_dir = d;
+	float a;
+	int k;
+
+	if (d < 3 || d > FLICK_DIR_MAX)
+		return -1;
+	param->flick_dir = d;
+	for (k = 0; k < d; k++) {
+		a = (2 * k + 1) * M_PI / d;
+		param->g_flick_sector[k][0] = sector_coord(cosf(a));
+		param->g_flick_sector[k][1] = sector_coord(sinf(a));
+	}
+	return 0;
 }
 
-void flick_reset(const struct utouch_frame *f)
+void flick_reset(struct gesture_ctx *ctx, const struct utouch_frame *f)
 {
+	struct flick_state *fs = &ctx->flick;
 	int i;
 	for (i = 0; i < DIM_FM; i++) {
-		mFlickDistance[i] = 0.0;
-		mFlickVelocity[i] = 0.0;
+		fs->distance[i] = 0;
+		fs->velocity[i] = 0;
 	}
+	fs->dist2 = 0;
+	fs->velo2 = 0;
+	fs->early_dir = 0;
+	fs->committed = 0;
 	if (f) {
-		mFlickStartTime = f->time;
-		mFlickPos_x = f->slots[f->current_slot]->x;
-		mFlickPos_y = f->slots[f->current_slot]->y;
+		fs->start_time = f->time;
+		fs->pos_x = f->slots[f->slot_revision].x;
+		fs->pos_y = f->slots[f->slot_revision].y;
 	} else {
-		mFlickStartTime = 0;
-		mFlickPos_x = 0.0;
-		mFlickPos_y = 0.0;
+		fs->start_time = 0;
+		fs->pos_x = 0;
+		fs->pos_y = 0;
 	}
+	fs->org_x = fs->pos_x;
+	fs->org_y = fs->pos_y;
 }
 
-void flick_update(const struct utouch_frame *f)
+void flick_update(struct gesture_ctx *ctx, const struct utouch_frame *f)
 {
+	struct flick_state *fs = &ctx->flick;
+	const struct gesture_param *gp = ctx->param;
 	utouch_frame_time_t dt;
 
 	if (flick_debug_print == 1) {
 	fprintf(stdout, "\t%s() - new xpos %.2f, before xpos %.2f\n", __func__,
-		f->slots[f->current_slot]->x, mFlickPos_x);
+		(float)f->slots[f->slot_revision].x, (float)fs->pos_x);
 	fprintf(stdout, "\t%s() - new ypos %.2f, before ypos %.2f\n", __func__,
-		f->slots[f->current_slot]->y, mFlickPos_y);
+		(float)f->slots[f->slot_revision].y, (float)fs->pos_y);
 	}
 
-	mFlickDistance[FM_X] +=
-		(f->slots[f->current_slot]->x - mFlickPos_x) / m_scale_ppm_x;
-	mFlickDistance[FM_Y] +=
-		(f->slots[f->current_slot]->y - mFlickPos_y) / m_scale_ppm_y;
-	mFlickPos_x = f->slots[f->current_slot]->x;
-	mFlickPos_y = f->slots[f->current_slot]->y;
-	dt = f->time - mFlickStartTime;
+#ifdef GESTURE_FIXED_POINT
+	/*
+	 * The float sum of the steps rounds each to nearest, truncating
+	 * them in Q16 would fall behind: convert the whole stroke at once.
+	 */
+	fs->distance[FM_X] =
+		gnum_from_units(f->slots[f->slot_revision].x - fs->org_x, gp->g_mm_x);
+	fs->distance[FM_Y] =
+		gnum_from_units(f->slots[f->slot_revision].y - fs->org_y, gp->g_mm_y);
+#else
+	fs->distance[FM_X] +=
+		gnum_from_units(f->slots[f->slot_revision].x - fs->pos_x, gp->g_mm_x);
+	fs->distance[FM_Y] +=
+		gnum_from_units(f->slots[f->slot_revision].y - fs->pos_y, gp->g_mm_y);
+#endif
+	fs->pos_x = f->slots[f->slot_revision].x;
+	fs->pos_y = f->slots[f->slot_revision].y;
+	dt = f->time - fs->start_time;
 	if (dt > 0) {
-		mFlickVelocity[FM_X] = mFlickDistance[FM_X] / dt;
-		mFlickVelocity[FM_Y] = mFlickDistance[FM_Y] / dt;
+		fs->velocity[FM_X] = gnum_div_int(fs->distance[FM_X], dt);
+		fs->velocity[FM_Y] = gnum_div_int(fs->distance[FM_Y], dt);
 	}
 
 	if (flick_debug_print == 1)
 	fprintf(stdout, "\t%s() - xDist:%.2f(mm), yDist:%.2f(mm), "
 		"xVelo:%.2f(mm/ms), yVelo:%.2f(mm/ms), time:%llu(ms)\n", __func__,
-		mFlickDistance[FM_X], mFlickDistance[FM_Y],
-		mFlickVelocity[FM_X], mFlickVelocity[FM_Y], dt);
+		gnum_to_float(fs->distance[FM_X]), gnum_to_float(fs->distance[FM_Y]),
+		gnum_to_float(fs->velocity[FM_X]), gnum_to_float(fs->velocity[FM_Y]),
+		dt);
 }
 
-static void flick_transform(const struct utouch_frame *f)
+/* lengths stay squared, the thresholds are squared to match */
+static void flick_transform(struct flick_state *fs,
+							 const struct utouch_frame *f)
 {
-	mFlickDistance[FM_R] =
-		hypotf(mFlickDistance[FM_X], mFlickDistance[FM_Y]);
-	if (mFlickDistance[FM_X] != 0.0)
-		mFlickDistance[FM_A] =
-			fabs(atan(mFlickDistance[FM_Y] / mFlickDistance[FM_X]));
-	else mFlickDistance[FM_A] = radian_90;
-	mFlickVelocity[FM_R] =
-		hypotf(mFlickVelocity[FM_X], mFlickVelocity[FM_Y]);
+	fs->dist2 = gnum_sq_sum(fs->distance[FM_X], fs->distance[FM_Y]);
+	fs->velo2 = gnum_sq_sum(fs->velocity[FM_X], fs->velocity[FM_Y]);
 
 	if (flick_debug_print == 1)
 	fprintf(stdout, "\t%s() - dist:%.2f(mm), velo:%.2f(mm/ms), "
-			"dir:%.2f(rad), time:%llu(ms)\n", __func__,
-			mFlickDistance[FM_R], mFlickVelocity[FM_R], mFlickDistance[FM_A],
-			(f->time - mFlickStartTime));
+			"time:%llu(ms)\n", __func__,
+			sqrtf(gnum_sq_to_float(fs->dist2)),
+			sqrtf(gnum_sq_to_float(fs->velo2)), (f->time - fs->start_time));
 }
 
-int flick_check(const struct utouch_frame *f)
+static int flick_limits(const struct gesture_param *gp,
+						const struct flick_state *fs, utouch_frame_time_t dt)
 {
-	utouch_frame_time_t dt;
-
-	flick_update(f);
-
-	if (mFlickDistance[0] == 0 && mFlickDistance[1] == 0)
+	if (fs->velo2 == 0)
 		return 0;
-
-	flick_transform(f);
-
-	if (mFlickVelocity[FM_R] == 0)
+	if (fs->dist2 == 0)
 		return 0;
-	if (mFlickDistance[FM_R] == 0)
+	if (fs->dist2 > gp->g_flick_dist_max2)
 		return 0;
-	if (mFlickDistance[FM_R] > flick_dist_max_threshold)
+	if (fs->dist2 < gp->g_flick_dist_min2)
 		return 0;
-	if (mFlickDistance[FM_R] < flick_dist_min_threshold)
+	if (fs->velo2 < gp->g_flick_velo_min2)
 		return 0;
-	if (mFlickVelocity[FM_R] < flick_velo_min_threshold)
+	if (dt > gp->flick_time_max_ms)
 		return 0;
-	dt = f->time - mFlickStartTime;
-	if (dt > flick_time_max_threshold)
+	if (dt < gp->flick_time_min_ms)
+		return 0;
+	return 1;
+}
+
+/* thresholds on the stroke so far, flick_update() must have run */
+static int flick_judge(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	struct flick_state *fs = &ctx->flick;
+	const struct gesture_param *gp = ctx->param;
+	utouch_frame_time_t dt;
+	gnum_t vx, vy;
+
+	if (fs->distance[0] == 0 && fs->distance[1] == 0)
 		return 0;
-	if (dt < flick_time_min_threshold)
+
+	/* judge on the release velocity rather than the stroke average */
+	if (motion_release_velocity(ctx, f, &vx, &vy)) {
+		fs->velocity[FM_X] = vx;
+		fs->velocity[FM_Y] = vy;
+	}
+
+	flick_transform(fs, f);
+
+	dt = f->time - fs->start_time;
+	if (!flick_limits(gp, fs, dt))
 		return 0;
 	if (flick_debug_print == 1)
 	fprintf(stdout, "\t%s() - dist:%.2f(mm), velo:%.2f(mm/ms), time:%llu(ms)\n",
-			__func__, mFlickDistance[FM_R], mFlickVelocity[FM_R], dt);
+			__func__, sqrtf(gnum_sq_to_float(fs->dist2)),
+			sqrtf(gnum_sq_to_float(fs->velo2)), dt);
 	return 1;   /* flick */
 }
 
-static int flick_direction_4()
+int flick_check(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	flick_update(ctx, f);
+	return flick_judge(ctx, f);
+}
+
+/* sectors by slope, |y| against |x| times the tangent of the boundary */
+static int flick_direction_4(const struct flick_state *fs)
 {
 	int dir;
-	if (mFlickDistance[FM_A] < radian_45)
+	if (gnum_abs(fs->distance[FM_Y]) < gnum_abs(fs->distance[FM_X]))
 		dir = 1;
 	else
 		dir = 2;
 	if (dir == 1) {
-		if (mFlickDistance[FM_X] >= 0)
+		if (fs->distance[FM_X] >= 0)
 			return 4;                   /* for East */
 		return 8;                       /* for West */
 	}
-	if (mFlickDistance[FM_Y] >= 0)
+	if (fs->distance[FM_Y] >= 0)
 		return 2;                       /* for South */
 	return 6;                           /* for North */
 }
 
-static int flick_direction_8()
+static int flick_direction_8(const struct flick_state *fs)
 {
+	gnum_t ax = gnum_abs(fs->distance[FM_X]);
+	gnum_t ay = gnum_abs(fs->distance[FM_Y]);
 	int dir;
-	if (mFlickDistance[FM_A] < radian_30)
+	if (ay < gnum_mul(ax, tan_30))
 		dir = 1;
-	else if (mFlickDistance[FM_A] > radian_60)
+	else if (ay >= gnum_mul(ax, tan_60))
 		dir = 3;
 	else
 		dir = 2;
 	if (dir == 1) {
-		if (mFlickDistance[FM_X] >= 0)
+		if (fs->distance[FM_X] >= 0)
 			return 4;       /* for East */
 		return 8;           /* for West */
 	}
 	if (dir == 3) {
-		if (mFlickDistance[FM_Y] >= 0)
+		if (fs->distance[FM_Y] >= 0)
 			return 2;       /* for South */
 		return 6;           /* for North */
 	}
-	if (mFlickDistance[FM_X] > 0 && mFlickDistance[FM_Y] > 0)
+	if (fs->distance[FM_X] > 0 && fs->distance[FM_Y] > 0)
 		return 3;           /* for SouthEast */
-	if (mFlickDistance[FM_X] < 0 && mFlickDistance[FM_Y] < 0)
+	if (fs->distance[FM_X] < 0 && fs->distance[FM_Y] < 0)
 		return 7;           /* for NorthWest */
-	if (mFlickDistance[FM_X] > 0 && mFlickDistance[FM_Y] < 0)
+	if (fs->distance[FM_X] > 0 && fs->distance[FM_Y] < 0)
 		return 5;           /* for NorthEast */
 	return 9;               /* for SouthWest */
 }
 
-static int flick_direction()
+/*
+ * Any other count: the stroke lies in sector k when it is
+ * counter-clockwise of boundary k - 1 but not of boundary k, tested
+ * by the sign of the cross products.
+ */
+static int flick_direction_n(const struct gesture_param *gp,
+							 const struct flick_state *fs)
 {
-	if (flick_dir == 4)
-		return flick_direction_4();
-	return flick_direction_8();
+	gnum_t x = fs->distance[FM_X];
+	gnum_t y = -fs->distance[FM_Y];		/* screen y grows downwards */
+	const gnum_t *b;
+	int k, ccw, prev;
+
+	b = gp->g_flick_sector[gp->flick_dir - 1];
+	prev = gnum_mul(b[0], y) >= gnum_mul(b[1], x);
+	for (k = 0; k < gp->flick_dir; k++) {
+		b = gp->g_flick_sector[k];
+		ccw = gnum_mul(b[0], y) >= gnum_mul(b[1], x);
+		if (prev && !ccw)
+			break;
+		prev = ccw;
+	}
+	if (k == gp->flick_dir)
+		k = 0;
+	return FLICK_ID_SECTOR + k;
+}
+
+static int flick_direction(const struct gesture_ctx *ctx)
+{
+	if (ctx->param->flick_dir == 4)
+		return flick_direction_4(&ctx->flick);
+	if (ctx->param->flick_dir == 8)
+		return flick_direction_8(&ctx->flick);
+	return flick_direction_n(ctx->param, &ctx->flick);
 }
 
-void flick_event(struct uinput_api *ua, const struct utouch_frame *f)
+void flick_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+				 const struct utouch_frame *f)
 {
-	ua->gestureId = flick_direction();
-	ua->valuators[0] = (u_int16_t)fabs(mFlickDistance[FM_X]);
-	ua->valuators[1] = (u_int16_t)fabs(mFlickDistance[FM_Y]);
-	ua->valuators[2] = (u_int16_t)(f->time - mFlickStartTime);
+	const struct flick_state *fs = &ctx->flick;
+
+	ua->gestureId = flick_direction(ctx);
+	ua->valuators[0] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_X]));
+	ua->valuators[1] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_Y]));
+	ua->valuators[2] = (u_int16_t)(f->time - fs->start_time);
+	uinput_Gesture(ua);
+}
+
+/*
+ * Judge a stroke measured by another recognizer (distance in mm,
+ * velocity in mm/ms, over dt ms) and report it like flick_event().
+ */
+int flick_stroke(struct gesture_ctx *ctx, struct uinput_api *ua,
+				 float dx, float dy, float vx, float vy,
+				 utouch_frame_time_t dt)
+{
+	struct flick_state *fs = &ctx->flick;
+
+	fs->distance[FM_X] = gnum_from_float(dx);
+	fs->distance[FM_Y] = gnum_from_float(dy);
+	fs->velocity[FM_X] = gnum_from_float(vx);
+	fs->velocity[FM_Y] = gnum_from_float(vy);
+	fs->dist2 = gnum_sq_sum(fs->distance[FM_X], fs->distance[FM_Y]);
+	fs->velo2 = gnum_sq_sum(fs->velocity[FM_X], fs->velocity[FM_Y]);
+	if (!flick_limits(ctx->param, fs, dt))
+		return 0;
+
+	ua->gestureId = flick_direction(ctx);
+	ua->valuators[0] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_X]));
+	ua->valuators[1] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_Y]));
+	ua->valuators[2] = (u_int16_t)dt;
+	uinput_Gesture(ua);
+	return 1;
+}
+
+/*
+ * Early commit, after flick_update() on a moving contact. The flick is
+ * reported once the stroke passes all thresholds in the same direction
+ * on two frames in a row.
+ */
+int flick_commit_check(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	struct flick_state *fs = &ctx->flick;
+	int dir;
+
+	if (fs->committed)
+		return 0;
+	if (!flick_judge(ctx, f)) {
+		fs->early_dir = 0;
+		return 0;
+	}
+	dir = flick_direction(ctx);
+	if (dir != fs->early_dir) {
+		fs->early_dir = dir;
+		return 0;
+	}
+	fs->committed = dir;
+	fs->committed_slot = f->slot_revision;
+	return 1;
+}
+
+/* true if the finger was moving back against the stroke at release */
+static int flick_reversed(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	const struct flick_state *fs = &ctx->flick;
+	const struct gesture_param *gp = ctx->param;
+	gnum_t vx, vy, v;
+
+	if (flick_direction(ctx) != fs->committed)
+		return 1;
+	if (fs->dist2 == 0 || !motion_release_velocity(ctx, f, &vx, &vy))
+		return 0;
+	/* release velocity along the stroke */
+	v = gnum_proj(vx, vy, fs->distance[FM_X], fs->distance[FM_Y], fs->dist2);
+	return v < -gp->g_flick_velo_min;
+}
+
+/*
+ * Touch-up of a contact whose flick was committed early: confirm it
+ * silently, or withdraw it if the stroke reversed or a second finger
+ * came down meanwhile.
+ */
+void flick_release(struct gesture_ctx *ctx, struct uinput_api *ua,
+				   const struct utouch_frame *f)
+{
+	struct flick_state *fs = &ctx->flick;
+
+	if (!ctx->multi_touch) {
+		flick_update(ctx, f);
+		flick_transform(fs, f);
+		if (!flick_reversed(ctx, f)) {
+			fs->committed = 0;
+			return;
+		}
+	}
+	if (flick_debug_print == 1)
+	fprintf(stdout, "\t%s() - cancel flick %d\n", __func__, fs->committed);
+	ua->gestureId = FLICK_ID_CANCEL;
+	ua->valuators[0] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_X]));
+	ua->valuators[1] = (u_int16_t)gnum_to_int(gnum_abs(fs->distance[FM_Y]));
+	ua->valuators[2] = fs->committed;
 	uinput_Gesture(ua);
+	fs->committed = 0;
 }
 /* EOF */
@@ -0,0 +1,275 @@
+/*
+ * Contact motion history
+ *
+ * Every active contact keeps a short ring of its recent positions.
+ * The velocity at any time is the least squares slope of position over
+ * the samples in a trailing time window, which follows the finger at
+ * release rather than the average of the whole stroke. A quadratic
+ * (constant acceleration) fit over the same kind of window extrapolates
+ * the position ahead of the last report.
+ */
+
+#include <math.h>
+
+#include "frame.h"
+#include "gesture.h"
+
+static void motion_add(struct motion_ring *m, const struct utouch_frame *f)
+{
+	struct motion_sample *s;
+
+	s = &m->s[m->head++ & (MOTION_DIM_SAMPLES - 1)];
+	s->time = f->time;
+	s->x = f->slots[f->slot_revision].x;
+	s->y = f->slots[f->slot_revision].y;
+	if (m->count < MOTION_DIM_SAMPLES)
+		m->count++;
+}
+
+void motion_begin(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	struct motion_ring *m = &ctx->motion[f->slot_revision];
+
+	m->head = 0;
+	m->count = 0;
+	motion_add(m, f);
+}
+
+void motion_update(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	motion_add(&ctx->motion[f->slot_revision], f);
+}
+
+/*
+ * Velocity of the current contact in surface units per ms, fitted over
+ * the samples no older than window ms before the newest one. Returns 0
+ * if fewer than two samples at distinct times are in the window.
+ */
+int motion_velocity(const struct gesture_ctx *ctx,
+					const struct utouch_frame *f, float window,
+					float *vx, float *vy)
+{
+	const struct motion_ring *m = &ctx->motion[f->slot_revision];
+	const struct motion_sample *s, *last;
+	float t, tm = 0, xm = 0, ym = 0, stt = 0, stx = 0, sty = 0;
+	unsigned int i, n;
+
+	if (m->count < 2)
+		return 0;
+	last = &m->s[(m->head - 1) & (MOTION_DIM_SAMPLES - 1)];
+	for (n = 0; n < m->count; n++) {
+		s = &m->s[(m->head - 1 - n) & (MOTION_DIM_SAMPLES - 1)];
+		if (last->time - s->time > window)
+			break;
+		/* times relative to the newest sample keep floats exact */
+		tm -= (float)(last->time - s->time);
+		xm += s->x;
+		ym += s->y;
+	}
+	if (n < 2)
+		return 0;
+	tm /= n;
+	xm /= n;
+	ym /= n;
+	for (i = 0; i < n; i++) {
+		s = &m->s[(m->head - 1 - i) & (MOTION_DIM_SAMPLES - 1)];
+		t = -(float)(last->time - s->time) - tm;
+		stt += t * t;
+		stx += t * (s->x - xm);
+		sty += t * (s->y - ym);
+	}
+	if (stt == 0)
+		return 0;
+	*vx = stx / stt;
+	*vy = sty / stt;
+	return 1;
+}
+
+/*
+ * Release velocity of the current contact in mm/ms, fitted as by
+ * motion_velocity() over the flick velocity window. Returns 0 if the
+ * window is off or holds too few samples. The fixed build solves the
+ * same fit on integers, as (n Stx - St Sx) / (n Stt - St^2) over times
+ * and positions relative to the newest sample.
+ */
+#ifdef GESTURE_FIXED_POINT
+/* q / d in Q16 surface units, converted to Q16 mm by s */
+static gnum_t units_to_mm(int64_t q, int64_t d, gscale_t s)
+{
+	int64_t v = (q * (1 << GNUM_SHIFT)) / d;
+
+	if (v < 0)
+		return -(gnum_t)((-v * s) >> 32);
+	return (gnum_t)((v * s) >> 32);
+}
+
+int motion_release_velocity(const struct gesture_ctx *ctx,
+							const struct utouch_frame *f,
+							gnum_t *vx, gnum_t *vy)
+{
+	const struct gesture_param *gp = ctx->param;
+	const struct motion_ring *m = &ctx->motion[f->slot_revision];
+	const struct motion_sample *s, *last;
+	int64_t t, x, y, st = 0, sx = 0, sy = 0, stt = 0, stx = 0, sty = 0;
+	int64_t den;
+	unsigned int n;
+
+	if (gp->flick_velo_window_ms == 0 || m->count < 2)
+		return 0;
+	last = &m->s[(m->head - 1) & (MOTION_DIM_SAMPLES - 1)];
+	for (n = 0; n < m->count; n++) {
+		s = &m->s[(m->head - 1 - n) & (MOTION_DIM_SAMPLES - 1)];
+		if (last->time - s->time > gp->flick_velo_window_ms)
+			break;
+		t = -(int64_t)(last->time - s->time);
+		x = s->x - last->x;
+		y = s->y - last->y;
+		st += t;
+		sx += x;
+		sy += y;
+		stt += t * t;
+		stx += t * x;
+		sty += t * y;
+	}
+	if (n < 2)
+		return 0;
+	den = n * stt - st * st;
+	if (den == 0)
+		return 0;
+	*vx = units_to_mm(n * stx - st * sx, den, gp->g_mm_x);
+	*vy = units_to_mm(n * sty - st * sy, den, gp->g_mm_y);
+	return 1;
+}
+#else
+int motion_release_velocity(const struct gesture_ctx *ctx,
+							const struct utouch_frame *f,
+							gnum_t *vx, gnum_t *vy)
+{
+	const struct gesture_param *gp = ctx->param;
+	float x, y;
+
+	if (gp->flick_velo_window <= 0 ||
+		!motion_velocity(ctx, f, gp->flick_velo_window, &x, &y))
+		return 0;
+	*vx = x / gp->scale_ppm_x;
+	*vy = y / gp->scale_ppm_y;
+	return 1;
+}
+#endif
+
+/*
+ * Least squares fit of p(t) = p0 + v t + a t^2 to n samples, t relative
+ * to the newest one. Returns 0 if the system is singular.
+ */
+static int fit_quadratic(const struct motion_ring *m, unsigned int n,
+						 float *vx, float *vy, float *ax, float *ay)
+{
+	const struct motion_sample *s, *last;
+	float t, t2, s0 = n, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+	float sx[3] = { 0, 0, 0 }, sy[3] = { 0, 0, 0 };
+	float c00, c01, c02, det;
+	unsigned int i;
+
+	last = &m->s[(m->head - 1) & (MOTION_DIM_SAMPLES - 1)];
+	for (i = 0; i < n; i++) {
+		s = &m->s[(m->head - 1 - i) & (MOTION_DIM_SAMPLES - 1)];
+		t = -(float)(last->time - s->time);
+		t2 = t * t;
+		s1 += t;
+		s2 += t2;
+		s3 += t2 * t;
+		s4 += t2 * t2;
+		sx[0] += s->x;
+		sx[1] += t * s->x;
+		sx[2] += t2 * s->x;
+		sy[0] += s->y;
+		sy[1] += t * s->y;
+		sy[2] += t2 * s->y;
+	}
+	/* Cramer's rule on the symmetric normal equations */
+	c00 = s2 * s4 - s3 * s3;
+	c01 = s1 * s4 - s2 * s3;
+	c02 = s1 * s3 - s2 * s2;
+	det = s0 * c00 - s1 * c01 + s2 * c02;
+	if (det == 0)
+		return 0;
+#define SOLVE_V(b) ((s0 * ((b)[1] * s4 - (b)[2] * s3) - (b)[0] * c01 + \
+					 s2 * (s1 * (b)[2] - s2 * (b)[1])) / det)
+#define SOLVE_A(b) ((s0 * (s2 * (b)[2] - s3 * (b)[1]) - \
+					 s1 * (s1 * (b)[2] - s2 * (b)[1]) + (b)[0] * c02) / det)
+	*vx = SOLVE_V(sx);
+	*vy = SOLVE_V(sy);
+	*ax = SOLVE_A(sx);
+	*ay = SOLVE_A(sy);
+#undef SOLVE_V
+#undef SOLVE_A
+	return 1;
+}
+
+/* h <= 0 reports raw positions */
+void motion_set_horizon(struct gesture_param *param, float h)
+{
+	param->predict_horizon = h;
+	param->predict_on = h > 0;
+}
+
+/*
+ * Position of the current contact predict_horizon ms after its last
+ * report, in surface units. Returns 0, leaving x and y alone, when
+ * there is not enough history or the finger is turning back.
+ */
+int motion_predict(const struct gesture_ctx *ctx,
+				   const struct utouch_frame *f, gcoord_t *x, gcoord_t *y)
+{
+	const struct gesture_param *gp = ctx->param;
+	const struct motion_ring *m = &ctx->motion[f->slot_revision];
+	const struct motion_sample *s, *last, *prev;
+	float h = gp->predict_horizon;
+	float vx, vy, ax = 0, ay = 0, dx, dy, d, dmax, px, py;
+	unsigned int n;
+
+	if (m->count < 2)
+		return 0;
+	last = &m->s[(m->head - 1) & (MOTION_DIM_SAMPLES - 1)];
+	prev = &m->s[(m->head - 2) & (MOTION_DIM_SAMPLES - 1)];
+	for (n = 1; n < m->count; n++) {
+		s = &m->s[(m->head - 1 - n) & (MOTION_DIM_SAMPLES - 1)];
+		if (last->time - s->time > gp->predict_window)
+			break;
+	}
+	if (n < 3 || !fit_quadratic(m, n, &vx, &vy, &ax, &ay)) {
+		if (!motion_velocity(ctx, f, gp->predict_window, &vx, &vy))
+			return 0;
+		ax = ay = 0;
+	}
+
+	/* the last step goes against the fit: reversal, stay raw */
+	if (vx * (last->x - prev->x) + vy * (last->y - prev->y) < 0)
+		return 0;
+	/* never extrapolate through a stop */
+	if ((vx + 2 * ax * h) * vx + (vy + 2 * ay * h) * vy < 0)
+		ax = ay = 0;
+
+	dx = vx * h + ax * h * h;
+	dy = vy * h + ay * h * h;
+	d = hypotf(dx / gp->scale_ppm_x, dy / gp->scale_ppm_y);
+	dmax = gp->predict_max_dist;
+	if (d > dmax) {
+		dx *= dmax / d;
+		dy *= dmax / d;
+	}
+	px = last->x + dx;
+	py = last->y + dy;
+	if (px < 0)
+		px = 0;
+	if (px > gp->device_xres - 1)
+		px = gp->device_xres - 1;
+	if (py < 0)
+		py = 0;
+	if (py > gp->device_yres - 1)
+		py = gp->device_yres - 1;
+	*x = px;
+	*y = py;
+	return 1;
+}
+/* EOF */
@@ -3,42 +3,59 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <linux/fb.h>
 #include <sys/ioctl.h>
 
-/* device parameters */
-static float m_screen_xres = 1024.0;	/* panel x resolution (pixel) */
-static float m_screen_yres = 600.0;		/* panel y resolution (pixel) */
-static float m_device_xres = 1024.0;	/* panel x resolution (pixel) */
-static float m_device_yres = 600.0;		/* panel y resolution (pixel) */
-static float m_phys_xsize  = 222.72;	/* panel size width (mm) */
-static float m_phys_ysize  = 125.25;	/* panel size height (mm) */
-static const float m_mapped_xres = 2048.0;	/* mapping x resolution (pixel) */
-static const float m_mapped_yres = 2048.0;	/* mapping y resolution (pixel) */
-
-float m_scale_x = 1.0;				/* mapping x pixel scale */
-float m_scale_y = 1.0;				/* mapping y pixel scale */
-float m_scale_ppm_x = 1.0;			/* pixel per mm */
-float m_scale_ppm_y = 1.0;			/* pixel per mm */
-
-/* flick threshold */
-float flick_dist_min_threshold = 10.0;     /* min distance */
-float flick_dist_max_threshold = 200.0;    /* max distance */
-float flick_velo_min_threshold = 150.0;      /* ave. velocity min (mm/s)*/
-float flick_time_min_threshold = 50.0;     /* min time */
-float flick_time_max_threshold = 300.0;    /* max time */
-
-/* pinching threshold */
-float pinch_dist_min_threshold = 4.0;      /* min distance */
+#include "frame.h"
+#include "gesture.h"
+
+/* default parameters */
+static const struct gesture_param default_param = {
+	/* device parameters */
+	.screen_xres = 1024.0,
+	.screen_yres = 600.0,
+	.device_xres = 1024.0,
+	.device_yres = 600.0,
+	.phys_xsize  = 222.72,
+	.phys_ysize  = 125.25,
+	.mapped_xres = 2048.0,
+	.mapped_yres = 2048.0,
+	.scale_x = 1.0,
+	.scale_y = 1.0,
+	.scale_ppm_x = 1.0,
+	.scale_ppm_y = 1.0,
+	.max_touch = 10,
+
+	/* flick threshold */
+	.flick_dir = 4,
+	.flick_dist_min_threshold = 10.0,      /* min distance */
+	.flick_dist_max_threshold = 200.0,     /* max distance */
+	.flick_velo_min_threshold = 150.0 / 1000,  /* 150 mm/s, in mm/ms */
+	.flick_time_min_threshold = 50.0,      /* min time */
+	.flick_time_max_threshold = 300.0,     /* max time */
+	.flick_velo_window = 50.0,             /* release velocity window */
+
+	/* pinching threshold */
+	.pinch_dist_min_threshold = 4.0,       /* min distance */
+
+	/* touch position prediction */
+	.predict_horizon = 0.0,                /* off */
+	.predict_window = 50.0,
+	.predict_max_dist = 8.0,
+};
 
 /* debug switch */
 int flick_debug_print = 0;
 int pinch_debug_print = 0;
 int touch_debug_print = 0;
 
-void get_scr_resolution()
+static void get_scr_resolution(struct gesture_param *gp)
 {
 	struct fb_var_screeninfo vinfo;
 	int fd = open("/dev/fb", O_RDWR);
@@ -47,13 +64,13 @@ void get_scr_resolution()
 		return;
 	}
 	if (ioctl(fd, FBIOGET_VSCREENINFO, &vinfo) == 0) {
-		m_screen_xres = vinfo.xres;
-		m_screen_yres = vinfo.yres;
+		gp->screen_xres = vinfo.xres;
+		gp->screen_yres = vinfo.yres;
 #if defined(FT5X06_TOUCHSCREEN)
 		/* x,y swap */
 		if (vinfo.yres > vinfo.xres) {
-			m_screen_xres = vinfo.yres;
-			m_screen_yres = vinfo.xres;
+			gp->screen_xres = vinfo.yres;
+			gp->screen_yres = vinfo.xres;
 		}
 #endif
 	}
@@ -86,13 +103,13 @@ enum {
 #define INFO_RESOLUTION_NAME	"mms_ts_resolution"
 #endif
 
-void get_tp_resolution()
+static void get_tp_resolution(struct gesture_param *gp)
 {
 #if defined(FT5X06_TOUCHSCREEN)
-	m_device_xres = 1280;	/* x resolution */
-	m_device_yres = 800;	/* y resolution */
-	m_phys_xsize  = 216.96;	/* panel size width (mm) */
-	m_phys_ysize  = 135.60;	/* panel size height (mm) */
+	gp->device_xres = 1280;	/* x resolution */
+	gp->device_yres = 800;	/* y resolution */
+	gp->phys_xsize  = 216.96;	/* panel size width (mm) */
+	gp->phys_ysize  = 135.60;	/* panel size height (mm) */
 #elif defined(GET_RESOLUTION_FROM_SYSFS)
 	FILE *fp;
 	int x, y;
@@ -105,8 +122,8 @@ void get_tp_resolution()
 		return;
 	}
 	fclose(fp);
-	m_device_xres = x;
-	m_device_yres = y;
+	gp->device_xres = x;
+	gp->device_yres = y;
 #elif defined(GET_RESOLUTION_FROM_IOCTL)
 	int x, y;
 	int fd = open("/dev/mms_ts", O_RDWR);
@@ -114,8 +131,8 @@ void get_tp_resolution()
 		return;
 	if (ioctl(fd, IOCTL_GET_RESOLUTION_X, (unsigned long*)&x) == 0) {
 		if (ioctl(fd, IOCTL_GET_RESOLUTION_Y, (unsigned long*)&y) == 0) {
-			m_device_xres = x;
-			m_device_yres = y;
+			gp->device_xres = x;
+			gp->device_yres = y;
 		}
 	}
 	close(fd);
@@ -123,25 +140,199 @@ void get_tp_resolution()
 	return;
 }
 
-void gesture_init()
+static void derive_scales(struct gesture_param *gp)
+{
+	gp->scale_x = gp->mapped_xres / gp->device_xres;
+	gp->scale_y = gp->mapped_yres / gp->device_yres;
+	gp->scale_ppm_x = gp->device_xres / gp->phys_xsize;
+	gp->scale_ppm_y = gp->device_yres / gp->phys_ysize;
+
+	gp->g_scale_x = gscale_from_ratio(gp->mapped_xres, gp->device_xres);
+	gp->g_scale_y = gscale_from_ratio(gp->mapped_yres, gp->device_yres);
+	gp->g_mm_x = gscale_mm(gp->device_xres, gp->phys_xsize);
+	gp->g_mm_y = gscale_mm(gp->device_yres, gp->phys_ysize);
+	gp->g_flick_dist_min2 = gnum_sq_sum(gnum_from_float(gp->flick_dist_min_threshold), 0);
+	gp->g_flick_dist_max2 = gnum_sq_sum(gnum_from_float(gp->flick_dist_max_threshold), 0);
+	gp->g_flick_velo_min2 = gnum_sq_sum(gnum_from_float(gp->flick_velo_min_threshold), 0);
+	gp->g_flick_velo_min = gnum_from_float(gp->flick_velo_min_threshold);
+	flick_set_dir_div(gp, gp->flick_dir);
+	gp->g_pinch_dist_min = gnum_from_float(gp->pinch_dist_min_threshold);
+	pinch_set_weights(gp);
+	motion_set_horizon(gp, gp->predict_horizon);
+	/* dt < min and dt > max on whole ms */
+	gp->flick_time_min_ms = ceilf(gp->flick_time_min_threshold);
+	gp->flick_time_max_ms = floorf(gp->flick_time_max_threshold);
+	/* samples at most that many whole ms older */
+	gp->flick_velo_window_ms = gp->flick_velo_window > 0 ?
+		floorf(gp->flick_velo_window) : 0;
+}
+
+void gesture_init(struct gesture_param *gp)
+{
+	*gp = default_param;
+	get_scr_resolution(gp);
+	get_tp_resolution(gp);
+	derive_scales(gp);
+
+	fprintf(stderr, "%s() - screen  resolution %.1f x %.1f\n",
+			__func__, gp->screen_xres, gp->screen_yres);
+	fprintf(stderr, "%s() - device  resolution %.1f x %.1f\n",
+			__func__, gp->device_xres, gp->device_yres);
+	fprintf(stderr, "%s() - mapping resolution %.1f x %.1f\n",
+			__func__, gp->mapped_xres, gp->mapped_yres);
+	fprintf(stderr, "%s() - mapping scale x:%.2f, y:%.2f\n",
+			__func__, gp->scale_x, gp->scale_y);
+	fprintf(stderr, "%s() - x:%.2f pixel/mm, y:%.2f pixel/mm\n",
+			__func__, gp->scale_ppm_x, gp->scale_ppm_y);
+}
+
+/*
+ * configuration file keys, value = file value * scale, within min..max
+ * after scaling. Coordinates are 16 bit; lengths and velocities go
+ * through gnum_from_float(), as does any position in mm, which is at
+ * most the panel size.
+ */
+struct config_key {
+	const char	*name;
+	size_t		offset;
+	int			is_int;
+	float		scale;
+	double		min;
+	double		max;
+};
+
+#define KEY_FLOAT(n, s, lo, hi)	{ #n, offsetof(struct gesture_param, n), 0, s, lo, hi }
+#define KEY_INT(n, lo, hi)		{ #n, offsetof(struct gesture_param, n), 1, 1, lo, hi }
+
+#define KEY_RES_MAX		65535.0			/* pixel */
+#define KEY_MM_MAX		GNUM_FLOAT_MAX
+#define KEY_MS_MAX		3600000.0		/* one hour */
+
+static const struct config_key config_keys[] = {
+	KEY_FLOAT(device_xres, 1, 1, KEY_RES_MAX),
+	KEY_FLOAT(device_yres, 1, 1, KEY_RES_MAX),
+	KEY_FLOAT(phys_xsize, 1, 0, KEY_MM_MAX),
+	KEY_FLOAT(phys_ysize, 1, 0, KEY_MM_MAX),
+	KEY_FLOAT(mapped_xres, 1, 1, KEY_RES_MAX),
+	KEY_FLOAT(mapped_yres, 1, 1, KEY_RES_MAX),
+	KEY_INT(flick_dir, 3, FLICK_DIR_MAX),
+	KEY_FLOAT(flick_dist_min_threshold, 1, 0, KEY_MM_MAX),
+	KEY_FLOAT(flick_dist_max_threshold, 1, 0, KEY_MM_MAX),
+	KEY_FLOAT(flick_velo_min_threshold, 0.001, 0, KEY_MM_MAX),	/* mm/s in the file */
+	KEY_FLOAT(flick_time_min_threshold, 1, 0, KEY_MS_MAX),
+	KEY_FLOAT(flick_time_max_threshold, 1, 0, KEY_MS_MAX),
+	KEY_FLOAT(flick_velo_window, 1, 0, KEY_MS_MAX),
+	KEY_INT(flick_early, 0, 1),
+	KEY_FLOAT(pinch_dist_min_threshold, 1, 0, KEY_MM_MAX),
+	KEY_FLOAT(predict_horizon, 1, 0, KEY_MS_MAX),
+	KEY_FLOAT(predict_window, 1, 0, KEY_MS_MAX),
+	KEY_FLOAT(predict_max_dist, 1, 0, KEY_MM_MAX),
+};
+
+static const struct config_key *find_key(const char *name)
+{
+	const struct config_key *k;
+
+	for (k = config_keys; k < config_keys + sizeof(config_keys) /
+			sizeof(config_keys[0]); k++)
+		if (strcmp(k->name, name) == 0)
+			return k;
+	return NULL;
+}
+
+/* -1: not a number, -2: out of k's range; gp is only set on success */
+static int set_key(struct gesture_param *gp, const struct config_key *k,
+				   const char *value)
+{
+	char *end;
+	double v;
+
+	v = strtod(value, &end);
+	if (end == value || *end)
+		return -1;
+	v *= k->scale;
+	/* also rejects NaN, before it could reach a cast */
+	if (!(v >= k->min && v <= k->max))
+		return -2;
+	if (k->is_int) {
+		if (v != floor(v))
+			return -1;
+		*(int *)((char *)gp + k->offset) = (int)v;
+	} else {
+		*(float *)((char *)gp + k->offset) = v;
+	}
+	return 0;
+}
+
+/*
+ * Apply a configuration file on top of gp. Lines are "key = value",
+ * '#' starts a comment. On error gp is left as it was.
+ */
+int gesture_load_config(struct gesture_param *gp, const char *path)
+{
+	struct gesture_param tmp = *gp;
+	const struct config_key *k;
+	char line[256], name[64], value[64];
+	int lineno = 0, ret = 0, r;
+	char *p;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if ((p = strchr(line, '#')))
+			*p = '\0';
+		if (sscanf(line, " %63[a-z_] = %63s", name, value) != 2) {
+			if (sscanf(line, " %1s", value) == 1) {
+				fprintf(stderr, "error: %s:%d: syntax\n", path, lineno);
+				ret = -1;
+			}
+			continue;
+		}
+		k = find_key(name);
+		r = k ? set_key(&tmp, k, value) : -1;
+		if (r == -2) {
+			fprintf(stderr, "error: %s:%d: %s must be %g..%g\n",
+					path, lineno, name, k->min / k->scale,
+					k->max / k->scale);
+			ret = -1;
+		} else if (r < 0) {
+			fprintf(stderr, "error: %s:%d: bad key or value '%s'\n",
+					path, lineno, name);
+			ret = -1;
+		}
+	}
+	fclose(fp);
+	/* the checks on the keys pass the defaults unseen */
+	if (tmp.device_xres <= 0 || tmp.device_yres <= 0 ||
+		tmp.phys_xsize <= 0 || tmp.phys_ysize <= 0 ||
+		tmp.mapped_xres <= 0 || tmp.mapped_yres <= 0) {
+		fprintf(stderr, "error: %s: bad panel geometry\n", path);
+		ret = -1;
+	}
+	if (tmp.flick_time_max_threshold < tmp.flick_time_min_threshold) {
+		fprintf(stderr, "error: %s: flick_time_max_threshold is below "
+				"flick_time_min_threshold\n", path);
+		ret = -1;
+	}
+	if (ret < 0)
+		return ret;
+	derive_scales(&tmp);
+	*gp = tmp;
+	return 0;
+}
+
+void gesture_ctx_init(struct gesture_ctx *ctx,
+					  const struct gesture_param *param)
 {
-	get_scr_resolution();
-	get_tp_resolution();
-	m_scale_x = m_mapped_xres / m_device_xres;
-	m_scale_y = m_mapped_yres / m_device_yres;
-	m_scale_ppm_x = m_device_xres / m_phys_xsize;
-	m_scale_ppm_y = m_device_yres / m_phys_ysize;
-	flick_velo_min_threshold /= 1000;	/* mm/ms */
-
-	fprintf(stdout, "%s() - screen  resolution %.1f x %.1f\n",
-			__func__, m_screen_xres, m_screen_yres);
-	fprintf(stdout, "%s() - device  resolution %.1f x %.1f\n",
-			__func__, m_device_xres, m_device_yres);
-	fprintf(stdout, "%s() - mapping resolution %.1f x %.1f\n",
-			__func__, m_mapped_xres, m_mapped_yres);
-	fprintf(stdout, "%s() - mapping scale x:%.2f, y:%.2f\n",
-			__func__, m_scale_x, m_scale_y);
-	fprintf(stdout, "%s() - x:%.2f pixel/mm, y:%.2f pixel/mm\n",
-			__func__, m_scale_ppm_x, m_scale_ppm_y);
+	ctx->param = param;
+	ctx->multi_touch = 0;
+	touch_init(ctx);
+	flick_init(ctx);
+	pinch_init(ctx);
 }
 /* EOF */
@@ -11,81 +11,155 @@
 /* debug switch */
 extern int pinch_debug_print;
 
-extern float m_scale_ppm_x;
-extern float m_scale_ppm_y;
+/* the two lowest active slots make up the pinch */
+static int pinch_contacts(const struct utouch_frame *f,
+						  const struct utouch_contact **a,
+						  const struct utouch_contact **b)
+{
+	uint32_t mask = f->active_mask;
+
+	if (__builtin_popcount(mask) < 2)
+		return 0;
+	*a = &f->slots[__builtin_ctz(mask)];
+	mask &= mask - 1;
+	*b = &f->slots[__builtin_ctz(mask)];
+	return 1;
+}
+
+/* finger spread per axis (mm) */
+static void pinch_spread(const struct gesture_param *gp,
+						 const struct utouch_contact *a,
+						 const struct utouch_contact *b,
+						 gnum_t *dw, gnum_t *dh)
+{
+	*dw = gnum_abs(gnum_from_units(b->x - a->x, gp->g_mm_x));
+	*dh = gnum_abs(gnum_from_units(b->y - a->y, gp->g_mm_y));
+}
 
-extern float pinch_dist_min_threshold;
-static float mPinchingDistance[DIM_FM];
+/*
+ * Direction metric, growing with the finger spread: the float engine
+ * compares the coordinates times units per mm. The fixed build compares
+ * the same length squared, with (units per mm)^2 as Q28 weights relative
+ * to the larger axis.
+ */
+#ifdef GESTURE_FIXED_POINT
+#define PINCH_WEIGHT_SHIFT	28
 
-static float compute_distance(const struct utouch_frame *f)
+void pinch_set_weights(struct gesture_param *gp)
 {
-	float x1, y1, x2, y2, r;
-
-	x1 = f->slots[0]->x * m_scale_ppm_x;
-	y1 = f->slots[0]->y * m_scale_ppm_y;
-	x2 = f->slots[1]->x * m_scale_ppm_x;
-	y2 = f->slots[1]->y * m_scale_ppm_y;
-	r = hypotf((x2 - x1), (y2 - y1));
-	return r;
+	double wx = (double)gp->scale_ppm_x * gp->scale_ppm_x;
+	double wy = (double)gp->scale_ppm_y * gp->scale_ppm_y;
+	double w = wx > wy ? wx : wy;
+
+	gp->g_pinch_wx = llround(wx / w * (1 << PINCH_WEIGHT_SHIFT));
+	gp->g_pinch_wy = llround(wy / w * (1 << PINCH_WEIGHT_SHIFT));
 }
 
-void pinch_init()
+static gnum_sq_t pinch_metric(const struct gesture_param *gp,
+							  const struct utouch_contact *a,
+							  const struct utouch_contact *b)
+{
+	int64_t dx = b->x - a->x;
+	int64_t dy = b->y - a->y;
+
+	return dx * dx * gp->g_pinch_wx + dy * dy * gp->g_pinch_wy;
+}
+#else
+void pinch_set_weights(struct gesture_param *gp)
 {
 }
 
-void pinch_reset(const struct utouch_frame *f)
+static gnum_sq_t pinch_metric(const struct gesture_param *gp,
+							  const struct utouch_contact *a,
+							  const struct utouch_contact *b)
 {
+	float x1, y1, x2, y2;
+
+	x1 = a->x * gp->scale_ppm_x;
+	y1 = a->y * gp->scale_ppm_y;
+	x2 = b->x * gp->scale_ppm_x;
+	y2 = b->y * gp->scale_ppm_y;
+	return hypotf((x2 - x1), (y2 - y1));
+}
+#endif
+
+static gnum_sq_t compute_distance(const struct gesture_param *gp,
+								  const struct utouch_frame *f)
+{
+	const struct utouch_contact *a, *b;
+
+	if (!pinch_contacts(f, &a, &b))
+		return 0;
+	return pinch_metric(gp, a, b);
+}
+
+void pinch_init(struct gesture_ctx *ctx)
+{
+}
+
+void pinch_reset(struct gesture_ctx *ctx, const struct utouch_frame *f)
+{
+	struct pinch_state *ps = &ctx->pinch;
 	int i;
 	for (i = 0; i < DIM_FM; i++) {
-		mPinchingDistance[i] = 0.0;
+		ps->distance[i] = 0;
 	}
 	if (f->num_active < 2)
-		mPinchingDistance[FM_R] = 0.0;
+		ps->spread = 0;
 	else
-		mPinchingDistance[FM_R] = compute_distance(f);
+		ps->spread = compute_distance(ctx->param, f);
 }
 
-int pinch_check(const struct utouch_frame *f)
+int pinch_check(struct gesture_ctx *ctx, const struct utouch_frame *f)
 {
-	float dw, dh;
+	struct pinch_state *ps = &ctx->pinch;
+	const struct gesture_param *gp = ctx->param;
+	const struct utouch_contact *a, *b;
+	gnum_t dw, dh;
 
 	if (f->num_active < 2)
 		return 0;
-	dw = fabsf(f->slots[1]->x - f->slots[0]->x) / m_scale_ppm_x;
-	dh = fabsf(f->slots[1]->y - f->slots[0]->y) / m_scale_ppm_y;
-	if ((mPinchingDistance[FM_X] == 0) && (mPinchingDistance[FM_Y] == 0)) {
-		mPinchingDistance[FM_X] = dw;
-		mPinchingDistance[FM_Y] = dh;
+	if (!pinch_contacts(f, &a, &b))
+		return 0;
+	pinch_spread(gp, a, b, &dw, &dh);
+	if ((ps->distance[FM_X] == 0) && (ps->distance[FM_Y] == 0)) {
+		ps->distance[FM_X] = dw;
+		ps->distance[FM_Y] = dh;
 		return 0;   /* First pinching update */
 	}
-	if ((fabsf(dw - mPinchingDistance[FM_X]) >= pinch_dist_min_threshold) ||
-		(fabsf(dh - mPinchingDistance[FM_Y]) >= pinch_dist_min_threshold)) {
-		mPinchingDistance[FM_X] = dw;
-		mPinchingDistance[FM_Y] = dh;
+	if ((gnum_abs(dw - ps->distance[FM_X]) >= gp->g_pinch_dist_min) ||
+		(gnum_abs(dh - ps->distance[FM_Y]) >= gp->g_pinch_dist_min)) {
+		ps->distance[FM_X] = dw;
+		ps->distance[FM_Y] = dh;
 		return 1;   /* Need pinching report */
 	}
 	return 0;
 }
 
-static int pinch_direction(const struct utouch_frame *f)
+static int pinch_direction(struct gesture_ctx *ctx,
+						   const struct utouch_frame *f)
 {
-	float fCurr = mPinchingDistance[FM_R];
-	float r;
+	struct pinch_state *ps = &ctx->pinch;
+	gnum_sq_t fCurr = ps->spread;
+	gnum_sq_t r;
 	if (f->num_active < 2)
-		r = 0.0;
+		r = 0;
 	else
-		r = compute_distance(f);
-	mPinchingDistance[FM_R] = r;
+		r = compute_distance(ctx->param, f);
+	ps->spread = r;
 	if (r >= fCurr)
-		return 28;  /* pinch in *//* zoom in */
-	return 29;      /* pinch out *//* zoom out */
+		return PINCH_ID_IN;
+	return PINCH_ID_OUT;
 }
 
-void pinch_event(struct uinput_api *ua, const struct utouch_frame *f)
+void pinch_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+				 const struct utouch_frame *f)
 {
-	ua->gestureId = pinch_direction(f);
-	ua->valuators[0] = (u_int16_t)mPinchingDistance[FM_X];
-	ua->valuators[1] = (u_int16_t)mPinchingDistance[FM_Y];
+	const struct pinch_state *ps = &ctx->pinch;
+
+	ua->gestureId = pinch_direction(ctx, f);
+	ua->valuators[0] = (u_int16_t)gnum_to_int(ps->distance[FM_X]);
+	ua->valuators[1] = (u_int16_t)gnum_to_int(ps->distance[FM_Y]);
 	ua->valuators[2] = 0;
 	uinput_Gesture(ua);
 }
@@ -5,75 +5,78 @@
 #include <stdio.h>
 
 #include "frame.h"
-#include "uinput_api.h"
+#include "gesture.h"
 
 /* debug switch */
 extern int touch_debug_print;
 
-extern float m_scale_x;
-extern float m_scale_y;
-
-void touch_init()
+void touch_init(struct gesture_ctx *ctx)
 {
 }
 
-void touch_down_event(struct uinput_api *ua, struct utouch_frame *f)
+void touch_down_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					  struct utouch_frame *f)
 {
 	struct utouch_contact *t;
-	float val;
 
 	t = frame_get_slot(f);
 
-	val = (u_int16_t)t->x * m_scale_x;
-	ua->valuators[0] = (u_int16_t)val;
-	val = (u_int16_t)t->y * m_scale_y;
-	ua->valuators[1] = (u_int16_t)val;
+	ua->valuators[0] = gscale_apply((u_int16_t)t->x, ctx->param->g_scale_x);
+	ua->valuators[1] = gscale_apply((u_int16_t)t->y, ctx->param->g_scale_y);
 	if (touch_debug_print == 1)
 	fprintf(stdout, "%s() %d:(%f,%f)\n",
-			__func__, f->slot_revision, t->x, t->y);
-	if (f->slot_revision == 0) {
+			__func__, f->slot_revision, (float)t->x, (float)t->y);
+	if (ua->mt_slots) {
+		uinput_MtDown(ua, f->slot_revision);
+	} else if (f->slot_revision == 0) {
 		uinput_PenDown_1st(ua);
 	} else if (f->slot_revision == 1) {
 		uinput_PenDown_2nd(ua);
 	}
 }
 
-void touch_up_event(struct uinput_api *ua, struct utouch_frame *f)
+void touch_up_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					  struct utouch_frame *f)
 {
 	struct utouch_contact *t;
-	float val;
 
 	t = frame_get_slot(f);
 
-	val = (u_int16_t)t->x * m_scale_x;
-	ua->valuators[0] = (u_int16_t)val;
-	val = (u_int16_t)t->y * m_scale_y;
-	ua->valuators[1] = (u_int16_t)val;
+	ua->valuators[0] = gscale_apply((u_int16_t)t->x, ctx->param->g_scale_x);
+	ua->valuators[1] = gscale_apply((u_int16_t)t->y, ctx->param->g_scale_y);
 	if (touch_debug_print == 1)
 	fprintf(stdout, "%s() %d:(%f,%f)\n",
-			__func__, f->slot_revision, t->x, t->y);
-	if (f->slot_revision == 0) {
+			__func__, f->slot_revision, (float)t->x, (float)t->y);
+	if (ua->mt_slots) {
+		uinput_MtUp(ua, f->slot_revision);
+	} else if (f->slot_revision == 0) {
 		uinput_PenUp_1st(ua);
 	} else if (f->slot_revision == 1) {
 		uinput_PenUp_2nd(ua);
 	}
 }
 
-void touch_move_event(struct uinput_api *ua, struct utouch_frame *f)
+/* moves may be extrapolated, down and up always report raw positions */
+void touch_move_event(struct gesture_ctx *ctx, struct uinput_api *ua,
+					  struct utouch_frame *f)
 {
 	struct utouch_contact *t;
-	float val;
+	gcoord_t x, y;
 
 	t = frame_get_slot(f);
+	x = t->x;
+	y = t->y;
+	if (ctx->param->predict_on)
+		motion_predict(ctx, f, &x, &y);
 
-	val = (u_int16_t)t->x * m_scale_x;
-	ua->valuators[0] = (u_int16_t)val;
-	val = (u_int16_t)t->y * m_scale_y;
-	ua->valuators[1] = (u_int16_t)val;
+	ua->valuators[0] = gscale_apply((u_int16_t)x, ctx->param->g_scale_x);
+	ua->valuators[1] = gscale_apply((u_int16_t)y, ctx->param->g_scale_y);
 	if (touch_debug_print == 1)
-	fprintf(stdout, "%s() %d:(%f,%f)\n",
-			__func__, f->slot_revision, t->x, t->y);
-	if (f->slot_revision == 0) {
+	fprintf(stdout, "%s() %d:(%f,%f) -> (%f,%f)\n", __func__,
+			f->slot_revision, (float)t->x, (float)t->y, (float)x, (float)y);
+	if (ua->mt_slots) {
+		uinput_MtMove(ua, f->slot_revision);
+	} else if (f->slot_revision == 0) {
 		uinput_PenMove_1st(ua);
 	} else if (f->slot_revision == 1) {
 		uinput_PenMove_2nd(ua);
@@ -0,0 +1,89 @@
+/*
+ * Log-scale latency histograms.
+ *
+ * Each power of two is split into 4 linear buckets, so a percentile is
+ * known to within 25% with a fixed, allocation free table. Recording is
+ * a handful of integer operations and safe to do on every input frame.
+ */
+
+#include <string.h>
+
+#include "latency.h"
+
+static int bucket_index(uint64_t ns)
+{
+	int msb, idx;
+
+	if (ns < (1 << LAT_SUB_BITS))
+		return ns;
+	msb = 63 - __builtin_clzll(ns);
+	idx = ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) +
+		((ns >> (msb - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1));
+	if (idx >= LAT_DIM_BUCKETS)
+		idx = LAT_DIM_BUCKETS - 1;
+	return idx;
+}
+
+/* smallest value of bucket idx */
+static uint64_t bucket_base(int idx)
+{
+	int shift, sub;
+
+	if (idx < (1 << LAT_SUB_BITS))
+		return idx;
+	shift = (idx >> LAT_SUB_BITS) - 1;
+	sub = idx & ((1 << LAT_SUB_BITS) - 1);
+	return (uint64_t)((1 << LAT_SUB_BITS) + sub) << shift;
+}
+
+void lat_hist_init(struct lat_hist *h, const char *name)
+{
+	memset(h, 0, sizeof(*h));
+	h->name = name;
+}
+
+void lat_hist_add(struct lat_hist *h, uint64_t ns)
+{
+	h->bucket[bucket_index(ns)]++;
+	h->count++;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+/* upper bound of the bucket holding the p-th percentile, in ns */
+uint64_t lat_hist_percentile(const struct lat_hist *h, double p)
+{
+	uint64_t rank, seen = 0, v;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+	rank = (uint64_t)(p * h->count / 100);
+	if (rank >= h->count)
+		rank = h->count - 1;
+	for (i = 0; i < LAT_DIM_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen > rank)
+			break;
+	}
+	v = i + 1 < LAT_DIM_BUCKETS ? bucket_base(i + 1) - 1 : h->max;
+	return v < h->max ? v : h->max;
+}
+
+void lat_hist_print(const struct lat_hist *h, FILE *fp)
+{
+	fprintf(fp, "  %-6s n %llu p50 %.1f p99 %.1f max %.1f (us)\n",
+			h->name, (unsigned long long)h->count,
+			lat_hist_percentile(h, 50) / 1000.0,
+			lat_hist_percentile(h, 99) / 1000.0,
+			h->max / 1000.0);
+}
+
+uint64_t lat_now(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/* EOF */
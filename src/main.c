@@ -8,125 +8,109 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <signal.h>
+#include <libgen.h>
+#include <getopt.h>
 
-#include "mtdev.h"
+#include "mtdev-plumbing.h"
+#include "evloop.h"
 #include "uinput_api.h"
-#include "frame.h"
+#include "engine.h"
 #include "gesture.h"
+#include "replay.h"
+#include "realtime.h"
 
-static int mRunning = 0;
-static struct mtdev *mpDev = NULL;
-static struct uinput_api *mpUa = NULL;
-static int mFd = -1;
-static int mMultiTouch = 0;
+/* input devices served by this process */
+#define MAX_DEVICES 8
 
-#define MAX_TOUCH 2
-static struct utouch_frame *mpFrame = NULL;
+struct jg_device {
+	char				*path;
+	int					fd;
+	int					grabbed;
+	struct mtdev		*dev;
+	struct uinput_api	*ua;
+	struct engine		*eng;
+};
+
+static struct evloop *mpLoop = NULL;
+static struct jg_device mDevices[MAX_DEVICES];
+static int mNumDevices = 0;
+static int mNumOpen = 0;
+static int mSharedOutput = 0;
+static int mMtOutput = 0;		/* type B output device */
+static int mWriterThread = 0;	/* output written by a thread */
+static struct uinput_api *mpSharedUa = NULL;
+static struct gesture_param mBaseParam;	/* probed + command line */
+static struct gesture_param *mpParam = NULL;	/* in use, immutable */
+static char *mConfigPath = NULL;
+static char *mConfigName = NULL;
+static int mConfigFd = -1;
+static char *mReplayPath = NULL;	/* offline run, see run_replay() */
+static char *mOutPath = "-";
+static int mRtPrio = 0;			/* SCHED_FIFO priority, 0: off */
+static char *mRtCpus = NULL;	/* CPU affinity list */
+static const struct recognizer *mpRecognizer = NULL;	/* NULL: native */
 
 /* debug switch */
-int event_debug_print = 0;
+extern int event_debug_print;
 extern int uinput_debug_print;
 extern int flick_debug_print;
 extern int pinch_debug_print;
 extern int touch_debug_print;
+extern int grail_debug_print;
 
-static void print_event(const struct input_event *ev)
+/* input event input */
+static int event_pull(struct jg_device *d, int fd)
 {
-	if (event_debug_print == 0)
-		return;
-	static const utouch_frame_time_t ms = 1000;
-	static int slot = 0;
-	utouch_frame_time_t evtime = ev->time.tv_usec / ms + ev->time.tv_sec * ms;
-	if (ev->type == EV_ABS && ev->code == ABS_MT_SLOT)
-		slot = ev->value;
-	fprintf(stderr, "%012llx %02d(%02d) %01d %04x %d\n",
-		evtime, slot, mpFrame->current_slot, ev->type, ev->code, ev->value);
-}
+	const struct input_event *ev;
+	int count = 0, i, n;
 
-/* Gesture recognizer */
-static int frame_sync()
-{
-	struct utouch_contact *t;
-	int i;
-	int num_active;
-
-	num_active = frame_active_nslot(mpFrame);
-
-	for (i = 0; i < MAX_TOUCH; i++) {
-		if (!frame_set_active_slot(mpFrame, i)) continue;
-		t = frame_get_slot(mpFrame);
-		switch (frame_get_slot_status(mpFrame)) {
-		case FRAME_STATUS_BEGIN:
-			if (num_active > 1)
-				mMultiTouch = 1;
-			else
-				mMultiTouch = 0;
-			if (!mMultiTouch)
-				flick_reset(mpFrame);
-			touch_down_event(mpUa, mpFrame);
-			frame_set_slot_status(mpFrame, FRAME_STATUS_UPDATE);
-			if (mMultiTouch)
-				pinch_reset(mpFrame);
-			break;
-		case FRAME_STATUS_UPDATE:
-			touch_move_event(mpUa, mpFrame);
-			if (mMultiTouch && pinch_check(mpFrame)) {
-				pinch_event(mpUa, mpFrame);
-			}
-			if (!mMultiTouch)
-				flick_update(mpFrame);
-			break;
-		case FRAME_STATUS_END:
-			if (!mMultiTouch && flick_check(mpFrame)) {
-				flick_event(mpUa, mpFrame);
-			}
-			touch_up_event(mpUa, mpFrame);
-			frame_set_slot_inactive(mpFrame);
-			break;
-		}
+	while ((n = mtdev_get_span(d->dev, fd, &ev)) > 0) {
+		for (i = 0; i < n; i++)
+			engine_event(d->eng, &ev[i]);
+		mtdev_get_consume(d->dev, n);
+		count += n;
 	}
-	return 1;
-}
-
-/* input event handler */
-static void tp_event(const struct input_event *ev)
-{
-	print_event(ev);
 
-	if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
-		frame_set_evtime(mpFrame, ev);
-		frame_sync();
-	} else if (ev->type == EV_ABS) {
-		frame_abs_event(mpFrame, ev);
-	}
+	return count;
 }
 
-/* input event input */
-#define NUM_EVENTS 32
-static int event_pull(struct mtdev *dev, int fd)
+static void close_device(struct jg_device *d)
 {
-	struct input_event ev[NUM_EVENTS];
-	int count = 0, i, len = sizeof(ev);
-
-	while (len == sizeof(ev)) {
-		len = mtdev_get(dev, fd, ev, NUM_EVENTS) * sizeof(struct input_event);
-		if (len <= 0) break;
-		if (len % sizeof(ev[0])) break;
-		for (i = 0; i < len / sizeof(ev[0]); i++) {
-			tp_event(&ev[i]);
-			count++;
-		}
-	}
-
-	return count > 0 ? count : 0;
+	if (d->fd < 0)
+		return;
+	if (mpLoop)
+		evloop_del(mpLoop, d->fd);
+	engine_delete(d->eng);
+	if (d->ua != mpSharedUa)
+		uinput_destroy(d->ua);
+	mtdev_close_delete(d->dev);
+	if (d->grabbed)
+		ioctl(d->fd, EVIOCGRAB, 0);
+	close(d->fd);
+	d->eng = NULL;
+	d->ua = NULL;
+	d->dev = NULL;
+	d->fd = -1;
+	mNumOpen--;
 }
 
-static void loop_mt_device(struct mtdev *dev, int fd)
+static void on_mt_device(struct evloop *loop, int fd, uint32_t events,
+						 void *data)
 {
-	int count;
-	while (!mtdev_idle(dev, fd, 5000)) {
-		count = event_pull(dev, fd);
+	struct jg_device *d = data;
+
+	if (events & EPOLLIN)
+		event_pull(d, fd);
+	if (events & (EPOLLHUP | EPOLLERR)) {
+		fprintf(stderr, "error: input device %s lost.\n", d->path);
+		close_device(d);
+		if (mNumOpen == 0)
+			evloop_quit(loop);
 	}
 }
 
@@ -152,21 +136,35 @@ static void show_mt_props(const struct mtdev *dev)
 	MTCHECK(dev, ABS_MT_DISTANCE);
 }
 
-static void on_terminate(int signal)
+static void on_terminate(struct evloop *loop, int signal, void *data)
 {
 	fprintf(stderr, "jgestured caught signal %d, terminate.\n", signal);
-	mRunning = 0;
+	evloop_quit(loop);
 }
 
-static void set_signal_handler()
+static void on_dump_stats(struct evloop *loop, int signal, void *data)
 {
-	sigset_t mask;
-	sigemptyset(&mask);
-	signal(SIGTERM, on_terminate);
-	signal(SIGINT, on_terminate);
-	sigaddset(&mask, SIGTERM);
-	sigaddset(&mask, SIGINT);
-	sigprocmask(SIG_UNBLOCK, &mask, NULL);
+	struct jg_device *d;
+	int i;
+
+	for (i = 0; i < mNumDevices; i++) {
+		d = &mDevices[i];
+		if (d->fd < 0)
+			continue;
+		fprintf(stderr, "%s latency:\n", d->path);
+		engine_print_stats(d->eng, stderr);
+	}
+}
+
+static int set_signal_handler(struct evloop *loop)
+{
+	if (evloop_signal(loop, SIGTERM, on_terminate, NULL) < 0)
+		return -1;
+	if (evloop_signal(loop, SIGINT, on_terminate, NULL) < 0)
+		return -1;
+	if (evloop_signal(loop, SIGUSR1, on_dump_stats, NULL) < 0)
+		return -1;
+	return 0;
 }
 
 static void debug_print_parse(char *optarg)
@@ -181,82 +179,572 @@ static void debug_print_parse(char *optarg)
 		pinch_debug_print = 1;
 	if (strchr(optarg, 't'))
 		touch_debug_print = 1;
+	if (strchr(optarg, 'g'))
+		grail_debug_print = 1;
 }
 
-int main(int argc, char *argv[])
+/* have the kernel stamp events with CLOCK_MONOTONIC if it can */
+static clockid_t set_event_clock(int fd)
+{
+#ifdef EVIOCSCLOCKID
+	int clk = CLOCK_MONOTONIC;
+
+	if (ioctl(fd, EVIOCSCLOCKID, &clk) == 0)
+		return CLOCK_MONOTONIC;
+#endif
+	return CLOCK_REALTIME;
+}
+
+static int open_device(struct jg_device *d)
 {
 	struct stat fs;
+	clockid_t clock;
+
+	d->fd = open(d->path, O_RDONLY | O_NONBLOCK);
+	if (d->fd < 0) {
+		fprintf(stderr, "error: could not open device %s\n", d->path);
+		return -1;
+	}
+	mNumOpen++;
+	if (fstat(d->fd, &fs)) {
+		fprintf(stderr, "error: could not stat the device\n");
+		goto error;
+	}
+	if (fs.st_rdev) {
+		if (ioctl(d->fd, EVIOCGRAB, 1)) {
+			fprintf(stderr, "error: could not grab the device\n");
+			goto error;
+		}
+		d->grabbed = 1;
+	}
+	clock = set_event_clock(d->fd);
+
+	d->dev = mtdev_new_open(d->fd);
+	if (!d->dev) {
+		fprintf(stderr, "error: could not open touch device\n");
+		goto error;
+	}
+	fprintf(stderr, "%s ", d->path);
+	show_mt_props(d->dev);
+
+	if (mSharedOutput)
+		d->ua = mpSharedUa;
+	else if (mMtOutput)
+		d->ua = uinput_new_mt(mpParam->max_touch);
+	else
+		d->ua = uinput_new();
+	if (d->ua && d->ua != mpSharedUa && mWriterThread &&
+		uinput_start_writer(d->ua) < 0) {
+		uinput_destroy(d->ua);
+		d->ua = NULL;
+	}
+	if (d->ua)
+		d->eng = engine_new(d->ua, mpParam, mpRecognizer);
+	if (!d->eng) {
+		fprintf(stderr, "error: could not set up gesture engine\n");
+		goto error;
+	}
+	engine_set_timing(d->eng, clock);
+	if (evloop_add(mpLoop, d->fd, on_mt_device, d) < 0) {
+		fprintf(stderr, "error: could not watch device %s\n", d->path);
+		goto error;
+	}
+	return 0;
+error:
+	close_device(d);
+	return -1;
+}
+
+/*
+ * Build a fresh parameter block from the base and the config file and
+ * hand it to every engine. The old block is no longer referenced once
+ * all engines have switched, which happens right here in the loop.
+ */
+static int load_config()
+{
+	struct gesture_param *gp;
+	int i;
+
+	gp = malloc(sizeof(*gp));
+	if (!gp)
+		return -1;
+	*gp = mBaseParam;
+	if (mConfigPath && gesture_load_config(gp, mConfigPath) < 0) {
+		free(gp);
+		return -1;
+	}
+	if (gp->flick_early && !engine_early_flick(mpRecognizer)) {
+		fprintf(stderr, "error: early flicks need the native engine\n");
+		free(gp);
+		return -1;
+	}
+	gp->max_touch = mBaseParam.max_touch;	/* fixed per engine */
+	for (i = 0; i < mNumDevices; i++)
+		if (mDevices[i].fd >= 0)
+			engine_set_param(mDevices[i].eng, gp);
+	free(mpParam);
+	mpParam = gp;
+	return 0;
+}
+
+static void on_config(struct evloop *loop, int fd, uint32_t events,
+					  void *data)
+{
+	char buf[4096] __attribute__((aligned(8)));
+	const struct inotify_event *ev;
+	int changed = 0;
+	ssize_t len;
+	char *p;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->len && strcmp(ev->name, mConfigName) == 0)
+				changed = 1;
+		}
+	}
+	if (!changed)
+		return;
+	if (load_config() == 0)
+		fprintf(stderr, "%s reloaded\n", mConfigPath);
+	else
+		fprintf(stderr, "error: %s not applied, keeping settings\n",
+				mConfigPath);
+}
+
+/* editors replace files, so watch the directory for the name */
+static int watch_config()
+{
+	char *dir, *name;
+	int fd;
+
+	dir = strdup(mConfigPath);
+	name = strdup(mConfigPath);
+	if (!dir || !name)
+		goto error;
+	mConfigName = strdup(basename(name));
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0 || !mConfigName ||
+		inotify_add_watch(fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+		evloop_add(mpLoop, fd, on_config, NULL) < 0) {
+		perror("inotify");
+		if (fd >= 0)
+			close(fd);
+		goto error;
+	}
+	mConfigFd = fd;
+	free(dir);
+	free(name);
+	return 0;
+error:
+	free(dir);
+	free(name);
+	return -1;
+}
+
+/*
+ * Offline mode: the recording goes through mtdev and the engine as fast
+ * as it can, timed by the recorded timestamps only, and the output
+ * events are written as evemu text stamped with the input frame time.
+ * No uinput device, no clock, so the output only depends on the
+ * recording and the parameters.
+ */
+static int run_replay()
+{
+	const struct input_event *ke;
+	struct input_event ev;
+	struct replay *rp;
+	struct uinput_api *ua = NULL;
+	struct engine *eng = NULL;
+	struct mtdev dev;
+	FILE *fp;
+	int ret = -1;
+
+	rp = replay_load(mReplayPath);
+	if (!rp) {
+		fprintf(stderr, "error: could not load %s\n", mReplayPath);
+		return -1;
+	}
+	fp = strcmp(mOutPath, "-") ? fopen(mOutPath, "w") : stdout;
+	if (!fp) {
+		perror(mOutPath);
+		goto out;
+	}
+	if (replay_init_mtdev(rp, &dev) < 0) {
+		fprintf(stderr, "error: could not set up mtdev\n");
+		goto out;
+	}
+	ua = uinput_new_file(fp, mMtOutput ? mpParam->max_touch : 0);
+	if (ua)
+		eng = engine_new(ua, mpParam, mpRecognizer);
+	if (!eng) {
+		fprintf(stderr, "error: could not set up gesture engine\n");
+		goto out_mtdev;
+	}
+
+	for (ke = rp->events; ke < rp->events + rp->nevents; ke++) {
+		mtdev_put_event(&dev, ke);
+		while (!mtdev_empty(&dev)) {
+			mtdev_get_event(&dev, &ev);
+			engine_event(eng, &ev);
+		}
+	}
+	uinput_flush(ua);
+	ret = 0;
+	if (fflush(fp)) {
+		perror(mOutPath);
+		ret = -1;
+	}
+
+	engine_delete(eng);
+out_mtdev:
+	uinput_destroy(ua);
+	mtdev_close(&dev);
+out:
+	if (fp && fp != stdout && fclose(fp))
+		ret = -1;
+	replay_free(rp);
+	return ret;
+}
+
+/*
+ * Synthetic session for check_no_alloc(): two fingers pinching out, then
+ * a one finger flick, a frame every 10 ms. Returns the event count.
+ */
+#define SELFTEST_DIM_EVENTS	256
+
+static void put_event(struct input_event *ev, int frame, int type, int code,
+					  int value)
+{
+	ev->time.tv_sec = 1 + frame / 100;
+	ev->time.tv_usec = (frame % 100) * 10000;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static int make_selftest(struct input_event *ev, int *nframes)
+{
+	int n = 0, f = 0, i;
+
+	for (i = 0; i < 10; i++, f++) {
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_SLOT, 0);
+		if (i == 0)
+			put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, 1);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_X, 400 - i * 10);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_Y, 300);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_SLOT, 1);
+		if (i == 0)
+			put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, 2);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_X, 600 + i * 10);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_Y, 300);
+		put_event(&ev[n++], f, EV_SYN, SYN_REPORT, 0);
+	}
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_SLOT, 0);
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_SLOT, 1);
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	put_event(&ev[n++], f++, EV_SYN, SYN_REPORT, 0);
+
+	f += 10;
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_SLOT, 0);
+	for (i = 0; i < 6; i++, f++) {
+		if (i == 0)
+			put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, 3);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_X, 200 + i * 60);
+		put_event(&ev[n++], f, EV_ABS, ABS_MT_POSITION_Y, 200);
+		put_event(&ev[n++], f, EV_SYN, SYN_REPORT, 0);
+	}
+	put_event(&ev[n++], f, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	put_event(&ev[n++], f++, EV_SYN, SYN_REPORT, 0);
+
+	*nframes = f;
+	return n;
+}
+
+/* check_no_alloc(): stop once the session has been read in full */
+static void on_selftest_done(struct evloop *loop, int fd, uint32_t events,
+							 void *data)
+{
+	struct jg_device *d = data;
+	uint64_t count;
+	int n;
+
+	/* level triggered, comes again after the device handler */
+	if (ioctl(d->fd, FIONREAD, &n) == 0 && n > 0)
+		return;
+	if (read(fd, &count, sizeof(count)) < 0)
+		perror("selftest: eventfd");
+	evloop_quit(loop);
+}
+
+/*
+ * The steady-state path, from the input fd through mtdev, the event
+ * loop and the engine to the output write, must not allocate: feed the
+ * synthetic session through a pipe to on_mt_device() in a scratch loop,
+ * with a scratch engine writing to /dev/null, once to settle lazy
+ * allocations (stdio buffers), then again with the guard armed.
+ */
+static int check_no_alloc()
+{
+	static struct input_event events[SELFTEST_DIM_EVENTS];
+	struct replay rp = { NULL, events, 0, 0 };
+	struct jg_device d = { "selftest", -1, 0, NULL, NULL, NULL };
+	struct evloop *loop = NULL;
+	struct mtdev dev;
+	unsigned long count = 0;
+	uint64_t one = 1;
+	int fd, pipefd[2] = { -1, -1 }, efd = -1, pass, ret = -1;
+
+	if (!rt_alloc_guard_ok()) {
+		fprintf(stderr, "realtime: no allocation guard, check skipped\n");
+		return 0;
+	}
+	rp.nevents = make_selftest(events, &rp.nframes);
+	fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		perror("/dev/null");
+		return -1;
+	}
+	/* the read end is non-blocking like a device, the session fits */
+	if (pipe(pipefd) < 0 || fcntl(pipefd[0], F_SETFL, O_NONBLOCK) < 0 ||
+		(efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		perror("selftest");
+		goto out;
+	}
+	d.fd = pipefd[0];
+	d.ua = uinput_new_sink(fd);
+	if (d.ua && mWriterThread && uinput_start_writer(d.ua) < 0)
+		goto out;
+	if (d.ua)
+		d.eng = engine_new(d.ua, mpParam, mpRecognizer);
+	if (!d.eng) {
+		fprintf(stderr, "error: could not set up gesture engine\n");
+		goto out;
+	}
+	loop = evloop_new();
+	if (!loop || evloop_add(loop, d.fd, on_mt_device, &d) < 0 ||
+		evloop_add(loop, efd, on_selftest_done, &d) < 0) {
+		fprintf(stderr, "error: could not set up event loop\n");
+		goto out;
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		if (replay_init_mtdev(&rp, &dev) < 0) {
+			fprintf(stderr, "error: could not set up mtdev\n");
+			goto out;
+		}
+		d.dev = &dev;
+		if (pass)
+			rt_alloc_guard_arm();
+		if (write(pipefd[1], events, rp.nevents * sizeof(events[0])) < 0 ||
+			write(efd, &one, sizeof(one)) < 0)
+			perror("selftest: write");
+		evloop_run(loop);
+		uinput_flush(d.ua);
+		if (pass)
+			count = rt_alloc_guard_disarm();
+		mtdev_close(&dev);
+		d.dev = NULL;
+	}
+	if (count) {
+		fprintf(stderr, "error: %lu heap allocations on the event path\n",
+				count);
+		goto out;
+	}
+	fprintf(stderr, "realtime: event path runs without heap allocation\n");
+	ret = 0;
+out:
+	evloop_destroy(loop);
+	engine_delete(d.eng);
+	uinput_destroy(d.ua);
+	if (efd >= 0)
+		close(efd);
+	if (pipefd[0] >= 0) {
+		close(pipefd[0]);
+		close(pipefd[1]);
+	}
+	close(fd);
+	return ret;
+}
+
+/* everything allocated and the threads running: lock it all in */
+static int start_realtime()
+{
+	if (check_no_alloc() < 0)
+		return -1;
+	if (rt_lock_memory() < 0)
+		return -1;
+	fprintf(stderr, "realtime: SCHED_FIFO priority %d%s%s, memory locked\n",
+			mRtPrio, mRtCpus ? ", cpus " : "", mRtCpus ? mRtCpus : "");
+	return 0;
+}
+
+enum {
+	OPT_REALTIME = 0x100,
+	OPT_CPU,
+	OPT_ENGINE,
+};
+
+static const struct option mLongOpts[] = {
+	{ "realtime", optional_argument, NULL, OPT_REALTIME },
+	{ "cpu", required_argument, NULL, OPT_CPU },
+	{ "engine", required_argument, NULL, OPT_ENGINE },
+	{ NULL, 0, NULL, 0 }
+};
+
+int main(int argc, char *argv[])
+{
 	int opt;
-	int opt_dir;
-	char *input_event_file = strdup("/dev/input/melfas0");
+	int opt_dir = 0;
+	int opt_touch = 0;
+	int opt_early = 0;
+	float opt_ahead = 0;
+	int i, ret = -1;
 
-	while ((opt = getopt(argc, argv, "d:i:p:")) != -1) {
+	while ((opt = getopt_long(argc, argv, "a:c:d:ei:mn:o:p:r:sw",
+							  mLongOpts, NULL)) != -1) {
 		switch (opt) {
+		case 'a':
+			opt_ahead = atof(optarg);
+			break;
+		case 'c':
+			mConfigPath = optarg;
+			break;
 		case 'd':
 			opt_dir = atoi(optarg);
-			flick_set_dir_div(opt_dir);
+			if (opt_dir < 3 || opt_dir > FLICK_DIR_MAX) {
+				fprintf(stderr, "error: directions must be 3..%d\n",
+						FLICK_DIR_MAX);
+				return -1;
+			}
+			break;
+		case 'e':
+			opt_early = 1;
 			break;
 		case 'i':
-			free(input_event_file);
-			input_event_file = strdup(optarg);
+			if (mNumDevices == MAX_DEVICES) {
+				fprintf(stderr, "error: too many devices\n");
+				return -1;
+			}
+			mDevices[mNumDevices++].path = optarg;
+			break;
+		case 'm':
+			mMtOutput = 1;
+			break;
+		case 'n':
+			opt_touch = atoi(optarg);
+			if (opt_touch < 1 || opt_touch > FRAME_MAX_SLOTS) {
+				fprintf(stderr, "error: contacts must be 1..%d\n",
+						FRAME_MAX_SLOTS);
+				return -1;
+			}
+			break;
+		case 'o':
+			mOutPath = optarg;
 			break;
 		case 'p':
 			debug_print_parse(optarg);
 			break;
+		case 'r':
+			mReplayPath = optarg;
+			break;
+		case 's':
+			mSharedOutput = 1;
+			break;
+		case 'w':
+			mWriterThread = 1;
+			break;
+		case OPT_REALTIME:
+			mRtPrio = optarg ? atoi(optarg) : RT_DEFAULT_PRIO;
+			if (mRtPrio < 1) {
+				fprintf(stderr, "error: bad realtime priority\n");
+				return -1;
+			}
+			break;
+		case OPT_CPU:
+			mRtCpus = optarg;
+			break;
+		case OPT_ENGINE:
+			mpRecognizer = engine_find_recognizer(optarg);
+			if (!mpRecognizer) {
+				fprintf(stderr, "error: unknown engine %s\n", optarg);
+				return -1;
+			}
+			break;
 		default:
-			fprintf(stderr, "Usage: %s [-d 4|8] [-i device]\n", argv[0]);
-			free(input_event_file);
+			fprintf(stderr, "Usage: %s [-a ms] [-c config] [-d dirs] [-e] "
+					"[-i device]... [-m] [-n contacts] [-s] [-w]\n"
+					"       [--engine=native|grail] [--realtime[=priority]] "
+					"[--cpu=list]\n"
+					"       %s [options] -r recording [-o output]\n"
+					"-e (flick_early) needs --engine=native\n",
+					argv[0], argv[0]);
 			return -1;
 		}
 	}
-
-	mFd = open(input_event_file, O_RDONLY | O_NONBLOCK);
-	if (mFd < 0) {
-		fprintf(stderr, "error: could not open device\n");
-		free(input_event_file);
+	if (mMtOutput && mSharedOutput) {
+		fprintf(stderr, "error: -m and -s cannot be combined\n");
 		return -1;
 	}
-	if (fstat(mFd, &fs)) {
-		fprintf(stderr, "error: could not stat the device\n");
+	if (mNumDevices == 0)
+		mDevices[mNumDevices++].path = "/dev/input/melfas0";
+	for (i = 0; i < mNumDevices; i++)
+		mDevices[i].fd = -1;
+
+	gesture_init(&mBaseParam);
+	if (opt_dir)
+		flick_set_dir_div(&mBaseParam, opt_dir);
+	if (opt_touch)
+		mBaseParam.max_touch = opt_touch;
+	mBaseParam.flick_early = opt_early;
+	motion_set_horizon(&mBaseParam, opt_ahead);
+	if (load_config() < 0)
 		goto exit_lbl;
-	}
-	if (fs.st_rdev && ioctl(mFd, EVIOCGRAB, 1)) {
-		fprintf(stderr, "error: could not grab the device\n");
+	if (mReplayPath) {
+		ret = run_replay();
 		goto exit_lbl;
 	}
 
-	mpDev = mtdev_new_open(mFd);
-	if (!mpDev) {
-		ioctl(mFd, EVIOCGRAB, 0);
-		fprintf(stderr, "error: could not open touch device\n");
+	/* before any thread is started, they inherit both */
+	if (mRtCpus && rt_set_affinity(mRtCpus) < 0)
+		goto exit_lbl;
+	if (mRtPrio && rt_set_priority(mRtPrio) < 0)
 		goto exit_lbl;
-	}
-	show_mt_props(mpDev);
-
-	mpUa = uinput_new();
-	mpFrame = create_frame(MAX_TOUCH);
-	gesture_init();
-	touch_init();
-	flick_init();
-	pinch_init();
-
-	mRunning = 1;
-	set_signal_handler();
-	while (mRunning)
-		loop_mt_device(mpDev, mFd);
 
-	uinput_destroy(mpUa);
-	mtdev_close_delete(mpDev);
+	mpLoop = evloop_new();
+	if (!mpLoop || set_signal_handler(mpLoop) < 0) {
+		fprintf(stderr, "error: could not set up event loop\n");
+		goto exit_lbl;
+	}
+	if (mConfigPath && watch_config() < 0)
+		goto exit_lbl;
+	if (mSharedOutput) {
+		mpSharedUa = uinput_new();
+		if (!mpSharedUa)
+			goto exit_lbl;
+		if (mWriterThread && uinput_start_writer(mpSharedUa) < 0)
+			goto exit_lbl;
+	}
+	for (i = 0; i < mNumDevices; i++)
+		if (open_device(&mDevices[i]) < 0)
+			goto exit_lbl;
+	if (mRtPrio && start_realtime() < 0)
+		goto exit_lbl;
 
-	if (fs.st_rdev)
-		ioctl(mFd, EVIOCGRAB, 0);
+	evloop_run(mpLoop);
+	ret = 0;
 
 exit_lbl:
-	close(mFd);
-	free(input_event_file);
-	if (mpFrame)
-		destroy_frame(mpFrame, MAX_TOUCH);
+	for (i = 0; i < mNumDevices; i++)
+		close_device(&mDevices[i]);
+	uinput_destroy(mpSharedUa);
+	evloop_destroy(mpLoop);
+	if (mConfigFd >= 0)
+		close(mConfigFd);
+	free(mpParam);
+	free(mConfigName);
 
-	return 0;
+	return ret;
 }
 /* EOF */
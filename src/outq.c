@@ -0,0 +1,195 @@
+/*
+ * Output frames handed to a writer thread.
+ *
+ * The engine pushes complete batches of events into a lock-free single
+ * producer, single consumer ring and goes back to reading input; the
+ * writer thread drains the ring into the output fd and is the only one
+ * to wait on a slow reader. A batch either fits as a whole or is refused
+ * and counted, the caller keeps it (see uinput_flush()).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "outq.h"
+
+#define OUTQ_MASK			(OUTQ_DIM_EVENTS - 1)
+/* up to PIPE_BUF a pipe takes all or nothing */
+#define OUTQ_WRITE_EVENTS	(PIPE_BUF / sizeof(struct input_event))
+
+static void wake(struct outq *q)
+{
+	uint64_t one = 1;
+
+	if (write(q->efd, &one, sizeof(one)) < 0)
+		perror("outq: eventfd");
+}
+
+/* write n events, waiting for the reader if it is behind */
+static int write_all(struct outq *q, const struct input_event *ev, int n)
+{
+	struct pollfd pfd = { q->fd, POLLOUT, 0 };
+	ssize_t len = n * sizeof(*ev), done = 0, ret;
+
+	while (done < len) {
+		ret = write(q->fd, (const char *)ev + done, len - done);
+		if (ret >= 0) {
+			done += ret;
+		} else if (errno == EAGAIN) {
+			poll(&pfd, 1, -1);
+		} else if (errno != EINTR) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* end-to-end latency of the reports just written, see outq_set_timing() */
+static void account(struct outq *q, const struct input_event *ev, int n)
+{
+	uint64_t now, t;
+	int i;
+
+	now = lat_now(q->clock);
+	for (i = 0; i < n; i++) {
+		if (ev[i].type != EV_SYN || ev[i].code != SYN_REPORT)
+			continue;
+		t = (uint64_t)ev[i].time.tv_sec * 1000000000 +
+			ev[i].time.tv_usec * 1000;
+		lat_hist_add(&q->lat_e2e, now > t ? now - t : 0);
+	}
+}
+
+static void *writer(void *arg)
+{
+	struct outq *q = arg;
+	unsigned int head, tail, n;
+	uint64_t count;
+
+	for (;;) {
+		head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+		tail = q->tail;
+		if (head == tail) {
+			if (__atomic_load_n(&q->quit, __ATOMIC_ACQUIRE))
+				break;
+			/* announce the sleep, then look again: see outq_push() */
+			__atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == tail &&
+				read(q->efd, &count, sizeof(count)) < 0 && errno != EINTR)
+				break;
+			__atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+			continue;
+		}
+		/* contiguous part, in pipe-atomic pieces */
+		n = head - tail;
+		if (n > OUTQ_DIM_EVENTS - (tail & OUTQ_MASK))
+			n = OUTQ_DIM_EVENTS - (tail & OUTQ_MASK);
+		if (n > OUTQ_WRITE_EVENTS)
+			n = OUTQ_WRITE_EVENTS;
+		if (write_all(q, &q->ev[tail & OUTQ_MASK], n) < 0) {
+			perror("outq: write");
+			__atomic_add_fetch(&q->errors, n, __ATOMIC_RELAXED);
+		} else if (q->timing) {
+			account(q, &q->ev[tail & OUTQ_MASK], n);
+		}
+		__atomic_store_n(&q->tail, tail + n, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+struct outq *outq_new(int fd)
+{
+	struct outq *q;
+
+	q = calloc(1, sizeof(*q));
+	if (!q)
+		return NULL;
+	q->fd = fd;
+	q->efd = eventfd(0, EFD_CLOEXEC);
+	if (q->efd < 0) {
+		perror("outq: eventfd");
+		free(q);
+		return NULL;
+	}
+	if (pthread_create(&q->thread, NULL, writer, q)) {
+		fprintf(stderr, "error: could not start the writer thread\n");
+		close(q->efd);
+		free(q);
+		return NULL;
+	}
+	return q;
+}
+
+/* the writer drains what is queued before it stops */
+void outq_destroy(struct outq *q)
+{
+	if (q) {
+		__atomic_store_n(&q->quit, 1, __ATOMIC_RELEASE);
+		wake(q);
+		pthread_join(q->thread, NULL);
+		close(q->efd);
+		free(q);
+	}
+}
+
+/* queue n events as one batch, returns n or 0 if the ring is too full */
+int outq_push(struct outq *q, const struct input_event *ev, int n)
+{
+	unsigned int head = q->head, tail, fill, part;
+
+	tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+	fill = head - tail;
+	if (n > OUTQ_DIM_EVENTS - fill) {
+		q->full++;
+		return 0;
+	}
+	part = OUTQ_DIM_EVENTS - (head & OUTQ_MASK);
+	if (part > n)
+		part = n;
+	memcpy(&q->ev[head & OUTQ_MASK], ev, part * sizeof(*ev));
+	memcpy(&q->ev[0], ev + part, (n - part) * sizeof(*ev));
+	/* either the writer sees the new head or we see it sleeping */
+	__atomic_store_n(&q->head, head + n, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST)) {
+		wake(q);
+		q->wakes++;
+	}
+
+	q->frames++;
+	q->events += n;
+	if (fill + n > q->max_fill)
+		q->max_fill = fill + n;
+	return n;
+}
+
+/*
+ * Time every report written from its event time stamp, which is that of
+ * the input SYN_REPORT, in clock. Set before the first push; later calls,
+ * from engines sharing the output, keep the first clock.
+ */
+void outq_set_timing(struct outq *q, clockid_t clock)
+{
+	if (q->timing)
+		return;
+	q->clock = clock;
+	lat_hist_init(&q->lat_e2e, "e2e");
+	q->timing = 1;
+}
+
+void outq_print_stats(const struct outq *q, FILE *fp)
+{
+	fprintf(fp, "writer: %lu batches, %lu events, %lu wakeups, "
+			"%lu refused (ring full), max fill %u/%d, "
+			"%lu lost to write errors\n",
+			q->frames, q->events, q->wakes, q->full, q->max_fill,
+			OUTQ_DIM_EVENTS, __atomic_load_n(&q->errors, __ATOMIC_RELAXED));
+	if (q->timing)
+		lat_hist_print(&q->lat_e2e, fp);
+}
+/* EOF */
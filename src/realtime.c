@@ -0,0 +1,218 @@
+/*
+ * Real-time setup of the daemon.
+ *
+ * SCHED_FIFO priority and CPU affinity are set before the devices and
+ * writer threads are created, which inherit both; the memory is locked
+ * once everything is allocated. The allocation guard interposes the
+ * glibc allocator so that startup can check that the event path does
+ * not touch the heap. The interposition is linked into the whole
+ * binary and is in place in every run, --realtime or not; unarmed it
+ * costs one relaxed load per call. free() is left to glibc.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "realtime.h"
+
+/* "0", "0,2" or "1-3" */
+int rt_set_affinity(const char *cpus)
+{
+	cpu_set_t set;
+	const char *p = cpus;
+	char *end;
+	long a, b;
+
+	CPU_ZERO(&set);
+	while (*p) {
+		a = strtol(p, &end, 10);
+		b = a;
+		if (end != p && *end == '-') {
+			p = end + 1;
+			b = strtol(p, &end, 10);
+		}
+		if (end == p || a < 0 || b < a || b >= CPU_SETSIZE ||
+			(*end && *end != ',')) {
+			fprintf(stderr, "error: bad cpu list %s\n", cpus);
+			return -1;
+		}
+		for (; a <= b; a++)
+			CPU_SET(a, &set);
+		p = *end ? end + 1 : end;
+	}
+	if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+		perror("error: sched_setaffinity");
+		return -1;
+	}
+	return 0;
+}
+
+int rt_set_priority(int prio)
+{
+	struct sched_param sp;
+
+	if (prio < sched_get_priority_min(SCHED_FIFO) ||
+		prio > sched_get_priority_max(SCHED_FIFO)) {
+		fprintf(stderr, "error: SCHED_FIFO priority must be %d..%d\n",
+				sched_get_priority_min(SCHED_FIFO),
+				sched_get_priority_max(SCHED_FIFO));
+		return -1;
+	}
+	memset(&sp, 0, sizeof(sp));
+	sp.sched_priority = prio;
+	if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0) {
+		perror("error: sched_setscheduler");
+		return -1;
+	}
+	return 0;
+}
+
+/* one store per page, through volatile so that none is optimized away */
+static void prefault_stack()
+{
+	char buf[RT_STACK_PREFAULT];
+	volatile char *p = buf;
+	long page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	if (page <= 0)
+		page = 4096;
+	for (i = 0; i < sizeof(buf); i += page)
+		p[i] = 0;
+}
+
+int rt_lock_memory()
+{
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		perror("error: mlockall");
+		return -1;
+	}
+	prefault_stack();
+	return 0;
+}
+
+#if defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+static int mGuardArmed = 0;
+static unsigned long mGuardCount = 0;
+
+static void guard_count()
+{
+	if (__atomic_load_n(&mGuardArmed, __ATOMIC_RELAXED))
+		__atomic_add_fetch(&mGuardCount, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+	guard_count();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	guard_count();
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+	guard_count();
+	return __libc_realloc(p, size);
+}
+
+void *reallocarray(void *p, size_t n, size_t size)
+{
+	size_t total;
+
+	guard_count();
+	if (__builtin_mul_overflow(n, size, &total)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return __libc_realloc(p, total);
+}
+
+void *memalign(size_t align, size_t size)
+{
+	guard_count();
+	return __libc_memalign(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+	guard_count();
+	if (align == 0 || (align & (align - 1))) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **pp, size_t align, size_t size)
+{
+	void *p;
+
+	guard_count();
+	if (align == 0 || (align & (align - 1)) || align % sizeof(void *))
+		return EINVAL;
+	p = __libc_memalign(align, size);
+	if (!p)
+		return ENOMEM;
+	*pp = p;
+	return 0;
+}
+
+void *valloc(size_t size)
+{
+	guard_count();
+	return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size)
+{
+	guard_count();
+	return __libc_pvalloc(size);
+}
+
+int rt_alloc_guard_ok()
+{
+	return 1;
+}
+
+#else
+
+static int mGuardArmed = 0;
+static unsigned long mGuardCount = 0;
+
+int rt_alloc_guard_ok()
+{
+	return 0;
+}
+
+#endif
+
+void rt_alloc_guard_arm()
+{
+	__atomic_store_n(&mGuardCount, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&mGuardArmed, 1, __ATOMIC_RELAXED);
+}
+
+unsigned long rt_alloc_guard_disarm()
+{
+	__atomic_store_n(&mGuardArmed, 0, __ATOMIC_RELAXED);
+	return __atomic_load_n(&mGuardCount, __ATOMIC_RELAXED);
+}
+/* EOF */
@@ -0,0 +1,229 @@
+/*
+ * Recorded input event streams.
+ *
+ * Recordings are read in the evemu text format, as written by
+ * evemu_write() and evemu_write_event(), or in the binary format of
+ * evrec.c. The device description is optional; without it the MT
+ * capabilities are taken from the events.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "evemu.h"
+#include "evrec.h"
+#include "replay.h"
+
+#define REPLAY_DIM_EVENTS	4096
+
+static int add_event(struct replay *rp, const struct input_event *ev, int *size)
+{
+	struct input_event *p;
+
+	if (rp->nevents == *size) {
+		p = realloc(rp->events, 2 * *size * sizeof(*p));
+		if (!p)
+			return -1;
+		rp->events = p;
+		*size *= 2;
+	}
+	rp->events[rp->nevents++] = *ev;
+	if (ev->type == EV_SYN && ev->code == SYN_REPORT)
+		rp->nframes++;
+	return 0;
+}
+
+/* device description of a binary recording, in evemu text */
+static struct evemu_device *read_desc(const struct evrec *r)
+{
+	struct evemu_device *dev;
+	FILE *fp;
+
+	if (!r->desc)
+		return NULL;
+	fp = fmemopen((void *)r->desc, r->desc_len, "r");
+	if (!fp)
+		return NULL;
+	dev = evemu_new(NULL);
+	if (dev && evemu_read(dev, fp) <= 0) {
+		evemu_delete(dev);
+		dev = NULL;
+	}
+	fclose(fp);
+	return dev;
+}
+
+static struct replay *load_binary(const char *path)
+{
+	struct replay *rp;
+	struct evrec *r;
+	int size;
+
+	r = evrec_open(path);
+	if (!r) {
+		fprintf(stderr, "error: %s: bad binary recording\n", path);
+		return NULL;
+	}
+	rp = calloc(1, sizeof(*rp));
+	if (!rp)
+		goto out;
+	size = r->nevents ? r->nevents : 1;
+	rp->events = malloc(size * sizeof(rp->events[0]));
+	if (!rp->events)
+		goto err;
+	rp->dev = read_desc(r);
+	while (rp->nevents < size &&
+		   evrec_read(r, &rp->events[rp->nevents]) > 0) {
+		if (rp->events[rp->nevents].type == EV_SYN &&
+			rp->events[rp->nevents].code == SYN_REPORT)
+			rp->nframes++;
+		rp->nevents++;
+	}
+	goto out;
+err:
+	replay_free(rp);
+	rp = NULL;
+out:
+	evrec_close(r);
+	return rp;
+}
+
+struct replay *replay_load(const char *path)
+{
+	struct replay *rp;
+	struct input_event ev;
+	int size = REPLAY_DIM_EVENTS;
+	FILE *fp;
+
+	if (strcmp(path, "-") && evrec_probe(path))
+		return load_binary(path);
+
+	if (strcmp(path, "-") == 0)
+		fp = stdin;
+	else
+		fp = fopen(path, "r");
+	if (!fp) {
+		perror("replay_load: fopen");
+		return NULL;
+	}
+
+	rp = calloc(1, sizeof(*rp));
+	if (!rp)
+		goto out;
+	rp->events = malloc(size * sizeof(rp->events[0]));
+	if (!rp->events)
+		goto err;
+
+	rp->dev = evemu_new(NULL);
+	if (rp->dev && evemu_read(rp->dev, fp) <= 0) {
+		evemu_delete(rp->dev);
+		rp->dev = NULL;
+	}
+	while (evemu_read_event(fp, &ev) > 0) {
+		if (add_event(rp, &ev, &size) < 0)
+			goto err;
+	}
+	goto out;
+err:
+	replay_free(rp);
+	rp = NULL;
+out:
+	if (fp != stdin)
+		fclose(fp);
+	return rp;
+}
+
+void replay_free(struct replay *rp)
+{
+	if (rp) {
+		if (rp->dev)
+			evemu_delete(rp->dev);
+		free(rp->events);
+		free(rp);
+	}
+}
+
+/* capabilities seen in the event stream, for bare recordings */
+static void scan_events(const struct replay *rp, int *has, int *max)
+{
+	const struct input_event *ev;
+
+	for (ev = rp->events; ev < rp->events + rp->nevents; ev++) {
+		if (ev->type != EV_ABS || ev->code < ABS_MT_SLOT ||
+			ev->code > ABS_MT_DISTANCE)
+			continue;
+		has[ev->code - ABS_MT_SLOT] = 1;
+		if (ev->value > max[ev->code - ABS_MT_SLOT])
+			max[ev->code - ABS_MT_SLOT] = ev->value;
+	}
+}
+
+/* the defaults mtdev_configure() applies to a kernel device */
+static void default_fuzz(struct mtdev *dev, int code, int sn)
+{
+	if (!mtdev_has_mt_event(dev, code) || mtdev_get_abs_fuzz(dev, code))
+		return;
+	mtdev_set_abs_fuzz(dev, code, (mtdev_get_abs_maximum(dev, code) -
+								   mtdev_get_abs_minimum(dev, code)) / sn);
+}
+
+static void set_defaults(struct mtdev *dev)
+{
+	if (!mtdev_has_mt_event(dev, ABS_MT_TRACKING_ID)) {
+		mtdev_set_abs_minimum(dev, ABS_MT_TRACKING_ID, MT_ID_MIN);
+		mtdev_set_abs_maximum(dev, ABS_MT_TRACKING_ID, MT_ID_MAX);
+	}
+	default_fuzz(dev, ABS_MT_POSITION_X, 250);
+	default_fuzz(dev, ABS_MT_POSITION_Y, 250);
+	default_fuzz(dev, ABS_MT_TOUCH_MAJOR, 100);
+	default_fuzz(dev, ABS_MT_TOUCH_MINOR, 100);
+	default_fuzz(dev, ABS_MT_WIDTH_MAJOR, 100);
+	default_fuzz(dev, ABS_MT_WIDTH_MINOR, 100);
+	default_fuzz(dev, ABS_MT_ORIENTATION, 10);
+}
+
+/*
+ * Set up the mtdev converter as if it had been configured from the
+ * recorded device.
+ */
+int replay_init_mtdev(const struct replay *rp, struct mtdev *dev)
+{
+	int has[ABS_MT_DISTANCE - ABS_MT_SLOT + 1];
+	int max[ABS_MT_DISTANCE - ABS_MT_SLOT + 1];
+	int code, i, hdr, ret;
+
+	ret = mtdev_init(dev);
+	if (ret)
+		return ret;
+
+	/* a header without MT axes does not describe the device */
+	hdr = rp->dev && evemu_has_event(rp->dev, EV_ABS, ABS_MT_POSITION_X);
+	memset(has, 0, sizeof(has));
+	memset(max, 0, sizeof(max));
+	if (!hdr)
+		scan_events(rp, has, max);
+
+	for (code = ABS_MT_SLOT; code <= ABS_MT_DISTANCE; code++) {
+		i = code - ABS_MT_SLOT;
+		if (hdr) {
+			if (!evemu_has_event(rp->dev, EV_ABS, code))
+				continue;
+			mtdev_set_mt_event(dev, code, 1);
+			mtdev_set_abs_minimum(dev, code,
+					evemu_get_abs_minimum(rp->dev, code));
+			mtdev_set_abs_maximum(dev, code,
+					evemu_get_abs_maximum(rp->dev, code));
+			mtdev_set_abs_fuzz(dev, code,
+					evemu_get_abs_fuzz(rp->dev, code));
+			mtdev_set_abs_resolution(dev, code,
+					evemu_get_abs_resolution(rp->dev, code));
+		} else if (has[i]) {
+			mtdev_set_mt_event(dev, code, 1);
+			mtdev_set_abs_maximum(dev, code, max[i]);
+		}
+	}
+	set_defaults(dev);
+	return 0;
+}
+/* EOF */
@@ -12,11 +12,15 @@
 #include <linux/uinput.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <limits.h>
 
+#include "evemu.h"
+#include "outq.h"
 #include "uinput_api.h"
 
 /* debug switch */
 int uinput_debug_print = 0;
+#define WRITE_EVENTS	(PIPE_BUF / sizeof(struct input_event))
 //#define INTERVAL(x) hard_sleep(x)
 #define INTERVAL(x)
 
@@ -90,22 +94,382 @@ static int create_uinput_device(int fd)
 	return 0;
 }
 
+/* native type B device, ABS_X/ABS_Y follow the lowest slot in use */
+static int create_mt_device(int fd, int nslots)
+{
+	struct uinput_user_dev uidev;
+	memset(&uidev, 0, sizeof(uidev));
+
+	snprintf(uidev.name, UINPUT_MAX_NAME_SIZE, "j3 gesture proxy mt");
+	uidev.id.bustype = BUS_VIRTUAL;
+	uidev.id.vendor  = 0xdead;
+	uidev.id.product = 0xbeef;
+	uidev.id.version = 2;
+	uidev.absmax[ABS_X] = 2047;
+	uidev.absmax[ABS_Y] = 2047;
+	uidev.absmax[ABS_MT_SLOT] = nslots - 1;
+	uidev.absmax[ABS_MT_TRACKING_ID] = 65535;
+	uidev.absmax[ABS_MT_POSITION_X] = 2047;
+	uidev.absmax[ABS_MT_POSITION_Y] = 2047;
+
+	if (write(fd, &uidev, sizeof(uidev)) < 0) {
+		perror("create_mt_device: write");
+		return -1;
+	}
+
+	ioctl_set(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
+	ioctl_set(fd, UI_SET_EVBIT, EV_SYN);
+
+	ioctl_set(fd, UI_SET_EVBIT, EV_KEY);
+	ioctl_set(fd, UI_SET_KEYBIT, BTN_TOUCH);
+	ioctl_set(fd, UI_SET_EVBIT, EV_ABS);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_X);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_Y);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_DISTANCE);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_MT_SLOT);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_MT_TRACKING_ID);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_MT_POSITION_X);
+	ioctl_set(fd, UI_SET_ABSBIT, ABS_MT_POSITION_Y);
+
+	ioctl_set(fd, UI_SET_EVBIT, EV_MSC);
+	ioctl_set(fd, UI_SET_MSCBIT, MSC_GESTURE);
+
+	if (ioctl(fd, UI_DEV_CREATE) < 0) {
+		perror("create_mt_device: ioctl");
+		return -1;
+	}
+
+	return 0;
+}
+
 static void destroy_uinput_device(int fd)
 {
 	if (ioctl(fd, UI_DEV_DESTROY) < 0)
 		perror("destroy_uinput_device: ioctl");
 }
 
-static void send_event(int fd, int type, int code, int value)
+static void sync_event(struct uinput_api *ua)
 {
-	struct input_event ev;
+	struct input_event *ev = &ua->events[ua->nevents++];
 
-	ev.type = type;
-	ev.code = code;
-	ev.value = value;
+	memset(ev, 0, sizeof(*ev));
+	ev->time = ua->time;
+	ev->type = EV_SYN;
+	ev->code = SYN_REPORT;
+	ua->nreport = ua->nevents;
+}
 
-	if (write(fd, &ev, sizeof(ev)) < 0)
-		perror("sent_event write");
+/* pointer axes and buttons, the state a reader keeps per slot */
+static int is_abs_axis(int type, int code)
+{
+	return type == EV_ABS && code <= ABS_RY && code != ABS_Z;
+}
+
+static int is_key(int type, int code)
+{
+	return type == EV_KEY && code >= BTN_MOUSE && code < BTN_MOUSE + 32;
+}
+
+/* same value as last queued, nothing for the reader to do */
+static int is_noop(struct uinput_api *ua, int type, int code, int value)
+{
+	u_int32_t bit;
+
+	if (is_abs_axis(type, code)) {
+		bit = 1U << code;
+		if ((ua->abs_known & bit) && ua->abs_last[code] == value)
+			return 1;
+		ua->abs_known |= bit;
+		ua->abs_last[code] = value;
+	} else if (is_key(type, code)) {
+		bit = 1U << (code - BTN_MOUSE);
+		if ((ua->key_known & bit) && !(ua->key_down & bit) == !value)
+			return 1;
+		ua->key_known |= bit;
+		ua->key_down = value ? ua->key_down | bit : ua->key_down & ~bit;
+	}
+	return 0;
+}
+
+/* append one event to the pending output as it is */
+static void queue_event(struct uinput_api *ua, int type, int code, int value)
+{
+	struct input_event *ev = &ua->events[ua->nevents++];
+
+	memset(ev, 0, sizeof(*ev));
+	ev->time = ua->time;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+/*
+ * The reader missed an unknown part of the output: queue the state as
+ * last queued in one report of its own, released buttons and contacts
+ * included, so that nothing is left pressed.
+ */
+static void resync(struct uinput_api *ua)
+{
+	struct uinput_slot *s;
+	int i, slot = -1;
+
+	for (i = 0; i <= ABS_RY; i++)
+		if (ua->abs_known & (1U << i))
+			queue_event(ua, EV_ABS, i, ua->abs_last[i]);
+	for (i = 0; i < 32; i++)
+		if (ua->key_known & (1U << i))
+			queue_event(ua, EV_KEY, BTN_MOUSE + i,
+					(ua->key_down >> i) & 1);
+	for (i = 0; i < ua->mt_slots; i++) {
+		if (!(ua->mt_reader & (1U << i)))
+			continue;
+		s = &ua->mt[i];
+		queue_event(ua, EV_ABS, ABS_MT_SLOT, i);
+		slot = i;
+		queue_event(ua, EV_ABS, ABS_MT_TRACKING_ID,
+				ua->mt_active & (1U << i) ? s->id : -1);
+		if (!(ua->mt_active & (1U << i)))
+			continue;
+		if (s->x >= 0)
+			queue_event(ua, EV_ABS, ABS_MT_POSITION_X, s->x);
+		if (s->y >= 0)
+			queue_event(ua, EV_ABS, ABS_MT_POSITION_Y, s->y);
+	}
+	/* the caller may go on in the slot it selected */
+	if (ua->mt_slot >= 0 && ua->mt_slot != slot)
+		queue_event(ua, EV_ABS, ABS_MT_SLOT, ua->mt_slot);
+	else if (ua->mt_slot < 0)
+		ua->mt_slot = slot;
+	if (ua->mt_slots && ua->mt_touch >= 0)
+		queue_event(ua, EV_KEY, BTN_TOUCH, ua->mt_touch);
+	if (ua->nevents)
+		sync_event(ua);
+}
+
+/* the queue could not be written, the reader gets the state anew */
+static void drop_events(struct uinput_api *ua)
+{
+	ua->dropped += ua->nevents;
+	ua->nevents = 0;
+	ua->nreport = 0;
+	ua->blocked = 0;
+	resync(ua);
+}
+
+static int is_mt_motion(int type, int code)
+{
+	return type == EV_ABS && (code == ABS_MT_SLOT ||
+			code == ABS_MT_POSITION_X || code == ABS_MT_POSITION_Y);
+}
+
+static int is_motion(const struct input_event *ev, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (!is_abs_axis(ev[i].type, ev[i].code) &&
+				!is_mt_motion(ev[i].type, ev[i].code))
+			return 0;
+	return 1;
+}
+
+/* slot selected after ev[0..n), slot being the one selected before */
+static int slot_after(const struct input_event *ev, int n, int slot)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (ev[i].type == EV_ABS && ev[i].code == ABS_MT_SLOT)
+			slot = ev[i].value;
+	return slot;
+}
+
+/* last index of code for slot in the motion events ev[0..n), or -1 */
+static int find_motion(const struct input_event *ev, int n, int s,
+		int slot, int code)
+{
+	int i, k = -1;
+
+	for (i = 0; i < n; i++) {
+		if (ev[i].code == ABS_MT_SLOT)
+			s = ev[i].value;
+		else if (ev[i].code == code && (code < ABS_MT_SLOT || s == slot))
+			k = i;
+	}
+	return k;
+}
+
+/*
+ * The reader is behind: reports holding only pointer or contact motion
+ * are folded into the motion report before them, so that it gets the
+ * latest positions instead of the whole path. Contact positions merge
+ * per slot; slot -1 stands for the one selected before the queue. The
+ * merged report ends in the slot the reports it replaces ended in.
+ * Button, tracking id and gesture reports are kept as they are, in
+ * order.
+ */
+static void coalesce(struct uinput_api *ua)
+{
+	struct input_event *ev = ua->events, e, syn;
+	int i, k, end, len, motion, o = 0, prev = -1, n = ua->nevents;
+	int slot = -1;		/* selected after ev[i - 1] */
+	int pslot = -1;		/* selected before the report at prev */
+	int oslot;			/* selected after ev[o - 1] */
+
+	for (i = 0; i < n; i = end + 1) {
+		for (end = i; ev[end].type != EV_SYN; end++)
+			;
+		len = end + 1 - i;
+		motion = is_motion(ev + i, end - i);
+		if (!motion || prev < 0) {
+			memmove(ev + o, ev + i, len * sizeof(*ev));
+			prev = motion ? o : -1;
+			pslot = slot;
+			slot = slot_after(ev + o, len, slot);
+			o += len;
+			continue;
+		}
+		/* reopen the previous report, its SYN_REPORT goes last again */
+		syn = ev[end];
+		o--;
+		oslot = slot;
+		for (; i < end; i++) {
+			e = ev[i];
+			if (e.code == ABS_MT_SLOT) {
+				slot = e.value;
+				continue;
+			}
+			k = find_motion(ev + prev, o - prev, pslot, slot, e.code);
+			if (k >= 0) {
+				ev[prev + k] = e;
+				ua->coalesced++;
+				continue;
+			}
+			/* each slot change consumed above makes room for this */
+			if (e.code > ABS_MT_SLOT && oslot != slot) {
+				ev[o] = e;
+				ev[o].code = ABS_MT_SLOT;
+				ev[o++].value = slot;
+				oslot = slot;
+			}
+			ev[o++] = e;
+		}
+		if (oslot != slot) {
+			ev[o] = syn;
+			ev[o].type = EV_ABS;
+			ev[o].code = ABS_MT_SLOT;
+			ev[o++].value = slot;
+		}
+		ev[o++] = syn;
+		ua->coalesced++;
+	}
+	ua->nevents = o;
+	ua->nreport = o;
+}
+
+static void write_events(struct uinput_api *ua)
+{
+	int i, n;
+
+	if (ua->fp) {
+		for (i = 0; i < ua->nevents; i++)
+			evemu_write_event(ua->fp, &ua->events[i]);
+	} else if (ua->q) {
+		if (ua->blocked)
+			coalesce(ua);
+		/* a full ring is a lagging reader, as EAGAIN below */
+		i = outq_push(ua->q, ua->events, ua->nevents);
+		ua->nevents -= i;
+		ua->nreport = ua->nevents;
+		ua->blocked = ua->nevents > 0;
+		return;
+	} else if (ua->fd >= 0) {
+		if (ua->blocked)
+			coalesce(ua);
+		/* up to PIPE_BUF a pipe takes all or nothing, uinput always all */
+		for (i = 0; i < ua->nevents; i += n) {
+			n = ua->nevents - i < WRITE_EVENTS ? ua->nevents - i : WRITE_EVENTS;
+			if (write(ua->fd, ua->events + i, n * sizeof(ua->events[0])) < 0)
+				break;
+		}
+		if (i < ua->nevents && errno != EAGAIN) {
+			perror("uinput_flush write");
+			drop_events(ua);
+			return;
+		}
+		memmove(ua->events, ua->events + i,
+				(ua->nevents - i) * sizeof(ua->events[0]));
+		ua->nevents -= i;
+		ua->nreport = ua->nevents;
+		ua->blocked = ua->nevents > 0;
+		return;
+	}
+	ua->nevents = 0;
+	ua->nreport = 0;
+}
+
+/*
+ * Queue one event into the current report. The events are written by
+ * uinput_flush() once per frame, terminated by a single SYN_REPORT.
+ */
+static void send_event(struct uinput_api *ua, int type, int code, int value)
+{
+	int i;
+
+	/* keep room for the terminating SYN_REPORT, drops resync the state */
+	if (ua->nevents >= UINPUT_DIM_EVENTS - 3) {
+		if (ua->nreport != ua->nevents)
+			sync_event(ua);
+		write_events(ua);
+		if (ua->nevents >= UINPUT_DIM_EVENTS - 3) {
+			if (!ua->dropped)
+				fprintf(stderr, "error: uinput output overrun, events "
+						"lost, see the SIGUSR1 stats\n");
+			drop_events(ua);
+		}
+	}
+	if (is_noop(ua, type, code, value)) {
+		ua->suppressed++;
+		return;
+	}
+	/* same code twice in one report, close the report first */
+	for (i = ua->nreport; i < ua->nevents && code < ABS_MT_SLOT; i++) {
+		if (ua->events[i].type == type && ua->events[i].code == code) {
+			sync_event(ua);
+			break;
+		}
+	}
+	queue_event(ua, type, code, value);
+}
+
+/* single touch emulation once per report, the lowest slot in use */
+static void mt_pointer(struct uinput_api *ua)
+{
+	int slot, touch = ua->mt_active != 0;
+
+	if (touch) {
+		slot = __builtin_ctz(ua->mt_active);
+		send_event(ua, EV_ABS, ABS_X, ua->mt[slot].x);
+		send_event(ua, EV_ABS, ABS_Y, ua->mt[slot].y);
+	}
+	if (touch != ua->mt_touch) {
+		send_event(ua, EV_KEY, BTN_TOUCH, touch);
+		ua->mt_touch = touch;
+	}
+}
+
+void uinput_flush(struct uinput_api *ua)
+{
+	if (ua->mt_slots)
+		mt_pointer(ua);
+	if (ua->nevents == 0)
+		return;
+	if (ua->nreport != ua->nevents)
+		sync_event(ua);
+	write_events(ua);
+	/* all written, released slots are known to the reader now */
+	if (ua->nevents == 0)
+		ua->mt_reader = ua->mt_active;
 }
 
 void uinput_write(struct uinput_api *ua, struct input_event *ie)
@@ -114,19 +478,40 @@ void uinput_write(struct uinput_api *ua, struct input_event *ie)
 	write(ua->fd, ie, sizeof(*ie));
 }
 
-struct uinput_api *uinput_new()
+static int open_uinput()
 {
-	struct uinput_api *x;
 	int fd;
 
 	fd = open("/dev/input/uinput", O_WRONLY | O_NONBLOCK);
 	if (fd < 0) {
 		fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
-		if (fd < 0) {
+		if (fd < 0)
 			perror("error: open uinput (out)");
-			return NULL;
-		}
 	}
+	return fd;
+}
+
+static void mt_init(struct uinput_api *ua, int nslots)
+{
+	int i;
+
+	ua->mt_slots = nslots;
+	ua->mt_slot = -1;
+	ua->mt_touch = 0;
+	for (i = 0; i < nslots; i++) {
+		ua->mt[i].id = -1;
+		ua->mt[i].x = ua->mt[i].y = -1;
+	}
+}
+
+struct uinput_api *uinput_new()
+{
+	struct uinput_api *x;
+	int fd;
+
+	fd = open_uinput();
+	if (fd < 0)
+		return NULL;
 
 	if (create_uinput_device(fd) < 0) {
 		close(fd);
@@ -144,21 +529,131 @@ struct uinput_api *uinput_new()
 	return x;
 }
 
+/*
+ * Multitouch output: contacts go out in nslots ABS_MT_SLOTs, with
+ * BTN_TOUCH and ABS_X/ABS_Y for single touch readers, gestures as on
+ * the two finger device.
+ */
+struct uinput_api *uinput_new_mt(int nslots)
+{
+	struct uinput_api *x;
+	int fd;
+
+	if (nslots < 1 || nslots > UINPUT_MAX_SLOTS)
+		return NULL;
+	fd = open_uinput();
+	if (fd < 0)
+		return NULL;
+
+	if (create_mt_device(fd, nslots) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	x = calloc(1, sizeof(*x));
+	if (!x) {
+		close(fd);
+		return NULL;
+	}
+
+	x->fd = fd;
+	mt_init(x, nslots);
+
+	return x;
+}
+
+/*
+ * Output without a uinput device: the events are written to fd as raw
+ * struct input_event, or dropped if fd is negative. The caller keeps
+ * ownership of fd.
+ */
+struct uinput_api *uinput_new_sink(int fd)
+{
+	struct uinput_api *x;
+
+	x = calloc(1, sizeof(*x));
+	if (!x)
+		return NULL;
+
+	x->fd = fd;
+	x->sink = 1;
+
+	return x;
+}
+
+/*
+ * Output as evemu text lines to fp, for offline runs, in multitouch
+ * form if mt_slots is not 0. The caller keeps ownership of fp.
+ */
+struct uinput_api *uinput_new_file(FILE *fp, int mt_slots)
+{
+	struct uinput_api *x;
+
+	if (mt_slots < 0 || mt_slots > UINPUT_MAX_SLOTS)
+		return NULL;
+	x = uinput_new_sink(-1);
+	if (x) {
+		x->fp = fp;
+		mt_init(x, mt_slots);
+	}
+
+	return x;
+}
+
+/*
+ * Hand the writes to a thread of their own, so that a slow reader of the
+ * output never holds up the input. Frames the ring cannot take stay
+ * queued and are coalesced as on EAGAIN.
+ */
+int uinput_start_writer(struct uinput_api *ua)
+{
+	if (ua->fd < 0 || ua->fp)
+		return -1;
+	ua->q = outq_new(ua->fd);
+	return ua->q ? 0 : -1;
+}
+
+/* with a writer thread, end-to-end latency is taken at its writes */
+int uinput_set_timing(struct uinput_api *ua, clockid_t clock)
+{
+	if (!ua->q)
+		return 0;
+	outq_set_timing(ua->q, clock);
+	return 1;
+}
+
+void uinput_print_stats(const struct uinput_api *ua, FILE *fp)
+{
+	fprintf(fp, "output: %lu no-op events suppressed, %lu coalesced, "
+			"%lu dropped\n", ua->suppressed, ua->coalesced, ua->dropped);
+	if (ua->q)
+		outq_print_stats(ua->q, fp);
+}
+
 void uinput_destroy(struct uinput_api *ua)
 {
 	if (ua) {
-		destroy_uinput_device(ua->fd);
-		close(ua->fd);
+		uinput_flush(ua);
+		/* what the ring or the reader did not take is lost */
+		if (ua->nevents) {
+			ua->dropped += ua->nevents;
+			fprintf(stderr, "error: uinput output, %d events lost "
+					"at exit\n", ua->nevents);
+		}
+		outq_destroy(ua->q);
+		if (!ua->sink) {
+			destroy_uinput_device(ua->fd);
+			close(ua->fd);
+		}
 		free(ua);
 	}
 }
 
 void uinput_PenDown_1st(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_X, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_Y, ua->valuators[1]);
-	send_event(ua->fd, EV_KEY, BTN_LEFT, 1);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_X, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_Y, ua->valuators[1]);
+	send_event(ua, EV_KEY, BTN_LEFT, 1);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - PenDown xpos:%4d  ypos:%4d\n",
 			__func__, ua->valuators[0], ua->valuators[1]);
@@ -167,10 +662,9 @@ void uinput_PenDown_1st(struct uinput_api *ua)
 
 void uinput_PenDown_2nd(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_RX, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_RY, ua->valuators[1]);
-	send_event(ua->fd, EV_KEY, BTN_EXTRA, 1);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_RX, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_RY, ua->valuators[1]);
+	send_event(ua, EV_KEY, BTN_EXTRA, 1);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - Second PenDown xpos:%4d  ypos:%4d\n",
 			__func__, ua->valuators[0], ua->valuators[1]);
@@ -178,10 +672,9 @@ void uinput_PenDown_2nd(struct uinput_api *ua)
 
 void uinput_PenUp_1st(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_X, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_Y, ua->valuators[1]);
-	send_event(ua->fd, EV_KEY, BTN_LEFT, 0);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_X, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_Y, ua->valuators[1]);
+	send_event(ua, EV_KEY, BTN_LEFT, 0);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - Sending PenUp (%dms)\n",
 			__func__, ua->valuators[2]);
@@ -190,10 +683,9 @@ void uinput_PenUp_1st(struct uinput_api *ua)
 
 void uinput_PenUp_2nd(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_RX, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_RY, ua->valuators[1]);
-	send_event(ua->fd, EV_KEY, BTN_EXTRA, 0);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_RX, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_RY, ua->valuators[1]);
+	send_event(ua, EV_KEY, BTN_EXTRA, 0);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - Second Sending PenUp (%dms)\n",
 			__func__, ua->valuators[2]);
@@ -201,9 +693,8 @@ void uinput_PenUp_2nd(struct uinput_api *ua)
 
 void uinput_PenMove_1st(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_X, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_Y, ua->valuators[1]);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_X, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_Y, ua->valuators[1]);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - Drag- x:%4d   y:%4d\n",
 			__func__, ua->valuators[0], ua->valuators[1]);
@@ -212,24 +703,92 @@ void uinput_PenMove_1st(struct uinput_api *ua)
 
 void uinput_PenMove_2nd(struct uinput_api *ua)
 {
-	send_event(ua->fd, EV_ABS, ABS_RX, ua->valuators[0]);
-	send_event(ua->fd, EV_ABS, ABS_RY, ua->valuators[1]);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_ABS, ABS_RX, ua->valuators[0]);
+	send_event(ua, EV_ABS, ABS_RY, ua->valuators[1]);
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - Second Drag- x:%4d  y:%4d\n",
 			__func__, ua->valuators[0], ua->valuators[1]);
 }
 
+static void mt_select(struct uinput_api *ua, int slot)
+{
+	if (ua->mt_slot != slot) {
+		send_event(ua, EV_ABS, ABS_MT_SLOT, slot);
+		ua->mt_slot = slot;
+	}
+}
+
+/* queue the changed coordinates of a slot, selecting it if needed */
+static void mt_position(struct uinput_api *ua, int slot)
+{
+	struct uinput_slot *s = &ua->mt[slot];
+	int x = ua->valuators[0], y = ua->valuators[1];
+
+	if (x == s->x && y == s->y) {
+		ua->suppressed++;
+		return;
+	}
+	mt_select(ua, slot);
+	if (x != s->x)
+		send_event(ua, EV_ABS, ABS_MT_POSITION_X, x);
+	if (y != s->y)
+		send_event(ua, EV_ABS, ABS_MT_POSITION_Y, y);
+	s->x = x;
+	s->y = y;
+}
+
+void uinput_MtDown(struct uinput_api *ua, int slot)
+{
+	struct uinput_slot *s;
+
+	if (slot < 0 || slot >= ua->mt_slots)
+		return;
+	s = &ua->mt[slot];
+	mt_select(ua, slot);
+	s->id = ua->mt_next_id++;
+	send_event(ua, EV_ABS, ABS_MT_TRACKING_ID, s->id);
+	mt_position(ua, slot);
+	ua->mt_active |= 1U << slot;
+	ua->mt_reader |= 1U << slot;
+	if (uinput_debug_print == 1)
+	fprintf(stdout, "%s() - slot %d id %d xpos:%4d  ypos:%4d\n",
+			__func__, slot, s->id, ua->valuators[0], ua->valuators[1]);
+}
+
+void uinput_MtUp(struct uinput_api *ua, int slot)
+{
+	if (slot < 0 || slot >= ua->mt_slots || !(ua->mt_active & (1U << slot)))
+		return;
+	mt_position(ua, slot);
+	mt_select(ua, slot);
+	send_event(ua, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	ua->mt[slot].id = -1;
+	ua->mt_active &= ~(1U << slot);
+	if (uinput_debug_print == 1)
+	fprintf(stdout, "%s() - slot %d (%dms)\n",
+			__func__, slot, ua->valuators[2]);
+}
+
+void uinput_MtMove(struct uinput_api *ua, int slot)
+{
+	if (slot < 0 || slot >= ua->mt_slots || !(ua->mt_active & (1U << slot)))
+		return;
+	mt_position(ua, slot);
+	if (uinput_debug_print == 1)
+	fprintf(stdout, "%s() - slot %d x:%4d   y:%4d\n",
+			__func__, slot, ua->valuators[0], ua->valuators[1]);
+}
+
 void uinput_Gesture(struct uinput_api *ua)
 {
 	int value;
 	value = ua->valuators[0];
 	value = value << 16 | ua->valuators[1];
-	send_event(ua->fd, EV_ABS, ABS_DISTANCE, value);
+	send_event(ua, EV_ABS, ABS_DISTANCE, value);
 	value = ua->gestureId;
 	value = value << 24 | ua->valuators[2];
-	send_event(ua->fd, EV_MSC, MSC_GESTURE, value);
-	send_event(ua->fd, EV_SYN, SYN_REPORT, 0);
+	send_event(ua, EV_MSC, MSC_GESTURE, value);
+	ua->gestures++;
 	if (uinput_debug_print == 1)
 	fprintf(stdout, "%s() - GestureId: %d, Period:%d, "
 					"xDist:%d, yDist:%d\n", __func__,
@@ -0,0 +1,250 @@
+/*
+ * Offline replay benchmark of the gesture pipeline.
+ *
+ * Recordings are fed through mtdev and the same engine_event() path as
+ * the daemon, with the output going to a null sink, once per recognizer
+ * backend so that they compare on the same input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "mtdev-plumbing.h"
+#include "uinput_api.h"
+#include "engine.h"
+#include "gesture.h"
+#include "replay.h"
+
+static int mIterations = 1;
+static const char *mEngine = NULL;	/* NULL: all of them */
+static struct uinput_api *mpUa = NULL;
+static struct gesture_param mParam;
+
+/*
+ * Gesture latency: from the first touch-down of a session (no contact
+ * before) to the input time of the frame with its first gesture report.
+ */
+struct gesture_lat {
+	u_int64_t	*v;			/* ns, one per session with a gesture */
+	int			n;
+	int			sessions;
+	unsigned long	gestures;
+};
+
+static u_int64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (u_int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static u_int64_t now_ns()
+{
+	return clock_ns(CLOCK_MONOTONIC);
+}
+
+static u_int64_t event_ns(const struct input_event *ev)
+{
+	return (u_int64_t)ev->time.tv_sec * 1000000000 + ev->time.tv_usec * 1000;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u_int64_t x = *(const u_int64_t *)a, y = *(const u_int64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static double percentile(const u_int64_t *v, int n, double p)
+{
+	int i = (int)(p * (n - 1) / 100 + 0.5);
+	return n ? v[i] / 1000.0 : 0.0;
+}
+
+/*
+ * replay once, frame processing times (ns) appended to ft, gesture
+ * latencies to gl
+ */
+static int replay_run(const struct replay *rp, struct engine *eng,
+					  u_int64_t *ft, struct gesture_lat *gl)
+{
+	const struct input_event *ke;
+	struct input_event ev;
+	struct mtdev dev;
+	u_int64_t t0 = 0, down = 0;
+	u_int32_t active = 0;
+	unsigned long gestures = mpUa->gestures;
+	int nft = 0, slot = 0, pending = 0;
+
+	if (replay_init_mtdev(rp, &dev) < 0)
+		return 0;
+	for (ke = rp->events; ke < rp->events + rp->nevents; ke++) {
+		if (!t0)
+			t0 = now_ns();
+		mtdev_put_event(&dev, ke);
+		while (!mtdev_empty(&dev)) {
+			mtdev_get_event(&dev, &ev);
+			engine_event(eng, &ev);
+			if (ev.type == EV_ABS && ev.code == ABS_MT_SLOT) {
+				slot = ev.value;
+			} else if (ev.type == EV_ABS &&
+					   ev.code == ABS_MT_TRACKING_ID && slot < 32) {
+				if (ev.value < 0) {
+					active &= ~(1U << slot);
+				} else {
+					if (!active && !pending) {
+						down = event_ns(&ev);
+						pending = 1;
+						gl->sessions++;
+					}
+					active |= 1U << slot;
+				}
+			} else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+				if (mpUa->gestures != gestures && pending) {
+					gl->v[gl->n++] = event_ns(&ev) - down;
+					pending = 0;
+				}
+				if (!active)
+					pending = 0;
+				gestures = mpUa->gestures;
+			}
+		}
+		if (ke->type == EV_SYN && ke->code == SYN_REPORT) {
+			ft[nft++] = now_ns() - t0;
+			t0 = 0;
+		}
+	}
+	mtdev_close(&dev);
+	return nft;
+}
+
+static int bench_engine(const struct replay *rp, const char *name,
+						u_int64_t *ft, u_int64_t *lat)
+{
+	struct gesture_lat gl;
+	struct engine *eng;
+	u_int64_t t, cpu;
+	unsigned long gestures;
+	int i, nft = 0;
+	double sec;
+
+	eng = engine_new(mpUa, &mParam, engine_find_recognizer(name));
+	if (!eng)
+		return -1;
+	memset(&gl, 0, sizeof(gl));
+	gl.v = lat;
+	gestures = mpUa->gestures;
+
+	t = now_ns();
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+	for (i = 0; i < mIterations; i++)
+		nft += replay_run(rp, eng, ft + nft, &gl);
+	cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+	sec = (now_ns() - t) / 1e9;
+	gl.gestures = mpUa->gestures - gestures;
+	qsort(ft, nft, sizeof(ft[0]), cmp_u64);
+	qsort(gl.v, gl.n, sizeof(gl.v[0]), cmp_u64);
+
+	fprintf(stdout, "  %s: %d iterations, %.3f s\n", name, mIterations, sec);
+	fprintf(stdout, "    events/s  %.0f\n", rp->nevents * mIterations / sec);
+	fprintf(stdout, "    frames/s  %.0f\n", nft / sec);
+	fprintf(stdout, "    frame time (us) p50 %.2f p90 %.2f p99 %.2f "
+			"p99.9 %.2f max %.2f\n",
+			percentile(ft, nft, 50), percentile(ft, nft, 90),
+			percentile(ft, nft, 99), percentile(ft, nft, 99.9),
+			percentile(ft, nft, 100));
+	fprintf(stdout, "    cpu per frame (us) %.2f\n",
+			nft ? cpu / 1e3 / nft : 0.0);
+	fprintf(stdout, "    gestures %lu, %d of %d sessions, first gesture "
+			"after touch-down (ms) p50 %.1f p90 %.1f max %.1f\n",
+			gl.gestures / mIterations, gl.n / mIterations,
+			gl.sessions / mIterations,
+			percentile(gl.v, gl.n, 50) / 1000, percentile(gl.v, gl.n, 90) / 1000,
+			percentile(gl.v, gl.n, 100) / 1000);
+
+	engine_delete(eng);
+	return 0;
+}
+
+static int bench_file(const char *path)
+{
+	struct replay *rp;
+	u_int64_t *ft, *lat;
+	const char *name;
+	int i, ret = 0;
+
+	rp = replay_load(path);
+	if (!rp) {
+		fprintf(stderr, "error: could not load %s\n", path);
+		return -1;
+	}
+	ft = malloc((rp->nframes * mIterations + 1) * sizeof(ft[0]));
+	lat = malloc((rp->nevents * mIterations + 1) * sizeof(lat[0]));
+	if (!ft || !lat) {
+		free(ft);
+		free(lat);
+		replay_free(rp);
+		return -1;
+	}
+
+	fprintf(stdout, "%s: %d events, %d frames\n",
+			path, rp->nevents, rp->nframes);
+	for (i = 0; (name = engine_recognizer_name(i)); i++) {
+		if (mEngine && strcmp(mEngine, name))
+			continue;
+		if (bench_engine(rp, name, ft, lat) < 0) {
+			fprintf(stderr, "error: could not set up the %s engine\n",
+					name);
+			ret = -1;
+		}
+	}
+
+	free(ft);
+	free(lat);
+	replay_free(rp);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "e:n:")) != -1) {
+		switch (opt) {
+		case 'e':
+			mEngine = optarg;
+			if (!engine_find_recognizer(mEngine)) {
+				fprintf(stderr, "error: unknown engine %s\n", mEngine);
+				return -1;
+			}
+			break;
+		case 'n':
+			mIterations = atoi(optarg);
+			if (mIterations < 1)
+				mIterations = 1;
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+	if (optind >= argc) {
+		fprintf(stderr, "Usage: %s [-e engine] [-n iterations] "
+				"recording...\n", argv[0]);
+		return -1;
+	}
+
+	mpUa = uinput_new_sink(-1);
+	if (!mpUa)
+		return -1;
+	gesture_init(&mParam);
+	for (; optind < argc; optind++)
+		if (bench_file(argv[optind]) < 0)
+			ret = -1;
+
+	uinput_destroy(mpUa);
+	return ret;
+}
+/* EOF */
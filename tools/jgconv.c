@@ -0,0 +1,136 @@
+/*
+ * Convert input event recordings between the evemu text format and
+ * the binary format of evrec.c. The direction follows the input file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "evemu.h"
+#include "evrec.h"
+
+/*
+ * Device description lines at the head of a text recording, kept
+ * verbatim. Returns the first event line, or NULL if there is none.
+ */
+static char *read_desc(FILE *fp, FILE *desc)
+{
+	char *line = NULL;
+	size_t size = 0;
+
+	while (getline(&line, &size, fp) > 0) {
+		if (strncmp(line, "E:", 2) == 0)
+			return line;
+		fputs(line, desc);
+	}
+	free(line);
+	return NULL;
+}
+
+static int parse_event(const char *line, struct input_event *ev)
+{
+	unsigned long sec;
+	unsigned usec, type, code;
+	int value;
+
+	if (sscanf(line, "E: %lu.%06u %04x %04x %d",
+			   &sec, &usec, &type, &code, &value) != 5)
+		return 0;
+	ev->time.tv_sec = sec;
+	ev->time.tv_usec = usec;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+	return 1;
+}
+
+static int text_to_binary(const char *in, const char *out)
+{
+	struct evrec_writer w;
+	struct input_event ev;
+	FILE *ifp, *ofp, *mfp;
+	char *desc = NULL, *line;
+	size_t len = 0;
+	int ret = -1;
+
+	ifp = strcmp(in, "-") ? fopen(in, "r") : stdin;
+	if (!ifp) {
+		perror(in);
+		return -1;
+	}
+	ofp = fopen(out, "w");
+	if (!ofp) {
+		perror(out);
+		goto out;
+	}
+	mfp = open_memstream(&desc, &len);
+	if (!mfp)
+		goto close;
+	line = read_desc(ifp, mfp);
+	fclose(mfp);
+	if (evrec_write_begin(&w, ofp, desc, len) == 0) {
+		ret = 0;
+		if (line && parse_event(line, &ev))
+			ret = evrec_write_event(&w, &ev);
+		while (ret == 0 && evemu_read_event(ifp, &ev) > 0)
+			ret = evrec_write_event(&w, &ev);
+		if (evrec_write_end(&w) < 0)
+			ret = -1;
+	}
+	if (ret < 0)
+		fprintf(stderr, "error: could not write %s\n", out);
+	free(line);
+	free(desc);
+close:
+	fclose(ofp);
+out:
+	if (ifp != stdin)
+		fclose(ifp);
+	return ret;
+}
+
+static int binary_to_text(const char *in, const char *out)
+{
+	struct input_event ev;
+	struct evrec *r;
+	FILE *ofp;
+	int ret;
+
+	r = evrec_open(in);
+	if (!r) {
+		fprintf(stderr, "error: %s: bad binary recording\n", in);
+		return -1;
+	}
+	ofp = strcmp(out, "-") ? fopen(out, "w") : stdout;
+	if (!ofp) {
+		perror(out);
+		evrec_close(r);
+		return -1;
+	}
+	if (r->desc)
+		fwrite(r->desc, r->desc_len, 1, ofp);
+	while ((ret = evrec_read(r, &ev)) > 0)
+		evemu_write_event(ofp, &ev);
+	if (ret < 0)
+		fprintf(stderr, "error: %s: truncated recording\n", in);
+	if (ofp != stdout)
+		fclose(ofp);
+	evrec_close(r);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s input output\n"
+				"  text input is written as binary, binary as text;\n"
+				"  \"-\" is stdin for text input, stdout for text output\n",
+				argv[0]);
+		return -1;
+	}
+	if (strcmp(argv[1], "-") && evrec_probe(argv[1]))
+		return binary_to_text(argv[1], argv[2]);
+	return text_to_binary(argv[1], argv[2]);
+}
+/* EOF */
@@ -0,0 +1,479 @@
+/*
+ * Synthetic multitouch load generator.
+ *
+ * Fingers touch down, drag or hold, lift and come back elsewhere at a
+ * fixed report rate, with optional position noise and report timing
+ * jitter. The stream goes out as an evemu text recording (a file or a
+ * pipe), as a binary recording, or through a uinput device for the
+ * daemon to read. The uinput output is paced in real time, the others
+ * only with -p.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include "evemu.h"
+#include "evrec.h"
+
+#define GEN_MAX_FINGERS	32
+
+enum noise_model { NOISE_NONE, NOISE_UNIFORM, NOISE_GAUSS };
+enum output { OUT_TEXT, OUT_BINARY, OUT_UINPUT };
+
+struct finger {
+	int down;
+	int id;				/* tracking id while down */
+	double x, y;		/* true position (units) */
+	double vx, vy;		/* units per s */
+	double left;		/* s until it lifts, or touches down again */
+	int major;
+	int rx, ry;			/* last reported position */
+};
+
+static int mFingers = 2;
+static int mRate = 60;
+static double mDuration = 10;
+static int mTypeA = 0;
+static int mXres = 1024;
+static int mYres = 600;
+static enum noise_model mNoise = NOISE_NONE;
+static double mNoiseAmp = 0;		/* units, sigma for gauss */
+static int mTimeJitter = 0;			/* us, +/- */
+static int mPaced = 0;
+static enum output mOutput = OUT_TEXT;
+static const char *mOutPath = "-";
+
+static struct finger mFinger[GEN_MAX_FINGERS];
+static int mNextId = 0;
+
+static FILE *mpText = NULL;
+static struct evrec_writer mWriter;
+static int mUinputFd = -1;
+static unsigned long mEvents = 0;
+
+static double frand(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+static double noise(void)
+{
+	double u, v;
+
+	switch (mNoise) {
+	case NOISE_UNIFORM:
+		return (2 * frand() - 1) * mNoiseAmp;
+	case NOISE_GAUSS:
+		/* Box-Muller */
+		u = 1 - frand();
+		v = frand();
+		return sqrt(-2 * log(u)) * cos(2 * M_PI * v) * mNoiseAmp;
+	default:
+		return 0;
+	}
+}
+
+/* a new stroke: flick, drag or hold, 0.1 to 1.5 s */
+static void touch_down(struct finger *f)
+{
+	double speed, dir, r = frand();
+
+	f->down = 1;
+	f->id = mNextId++ & 0xffff;
+	f->x = frand() * (mXres - 1);
+	f->y = frand() * (mYres - 1);
+	if (r < 0.2)
+		speed = mXres * (1 + 2 * frand());		/* flick */
+	else if (r < 0.7)
+		speed = mXres * 0.3 * frand();			/* drag */
+	else
+		speed = 0;								/* hold */
+	dir = 2 * M_PI * frand();
+	f->vx = speed * cos(dir);
+	f->vy = speed * sin(dir);
+	f->left = r < 0.2 ? 0.1 + 0.2 * frand() : 0.3 + 1.2 * frand();
+	f->major = 20 + rand() % 20;
+	f->rx = f->ry = -1;
+}
+
+static void move(struct finger *f, double dt)
+{
+	f->x += f->vx * dt;
+	f->y += f->vy * dt;
+	if (f->x < 0 || f->x > mXres - 1) {
+		f->vx = -f->vx;
+		f->x = f->x < 0 ? -f->x : 2 * (mXres - 1) - f->x;
+	}
+	if (f->y < 0 || f->y > mYres - 1) {
+		f->vy = -f->vy;
+		f->y = f->y < 0 ? -f->y : 2 * (mYres - 1) - f->y;
+	}
+}
+
+static int clamp(int v, int max)
+{
+	return v < 0 ? 0 : v > max ? max : v;
+}
+
+static int emit(const struct timeval *tv, int type, int code, int value)
+{
+	struct input_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.time = *tv;
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	mEvents++;
+	switch (mOutput) {
+	case OUT_TEXT:
+		return evemu_write_event(mpText, &ev) < 0 ? -1 : 0;
+	case OUT_BINARY:
+		return evrec_write_event(&mWriter, &ev);
+	default:
+		if (write(mUinputFd, &ev, sizeof(ev)) != sizeof(ev)) {
+			perror("jggen: write");
+			return -1;
+		}
+		return 0;
+	}
+}
+
+/* one report of all fingers, as a type A or type B panel sends it */
+static int report(const struct timeval *tv)
+{
+	struct finger *f;
+	int i, x, y, ret = 0, any = 0;
+
+	for (i = 0; i < mFingers; i++) {
+		f = &mFinger[i];
+		if (!f->down) {
+			if (!mTypeA && f->rx >= 0) {
+				ret |= emit(tv, EV_ABS, ABS_MT_SLOT, i);
+				ret |= emit(tv, EV_ABS, ABS_MT_TRACKING_ID, -1);
+				f->rx = f->ry = -1;
+			}
+			continue;
+		}
+		x = clamp(lrint(f->x + noise()), mXres - 1);
+		y = clamp(lrint(f->y + noise()), mYres - 1);
+		if (mTypeA) {
+			ret |= emit(tv, EV_ABS, ABS_MT_TOUCH_MAJOR, f->major);
+			ret |= emit(tv, EV_ABS, ABS_MT_POSITION_X, x);
+			ret |= emit(tv, EV_ABS, ABS_MT_POSITION_Y, y);
+			ret |= emit(tv, EV_SYN, SYN_MT_REPORT, 0);
+			any = 1;
+			continue;
+		}
+		/* the kernel drops unchanged values, so do we */
+		if (x == f->rx && y == f->ry)
+			continue;
+		ret |= emit(tv, EV_ABS, ABS_MT_SLOT, i);
+		if (f->rx < 0) {
+			ret |= emit(tv, EV_ABS, ABS_MT_TRACKING_ID, f->id);
+			ret |= emit(tv, EV_ABS, ABS_MT_TOUCH_MAJOR, f->major);
+		}
+		if (x != f->rx)
+			ret |= emit(tv, EV_ABS, ABS_MT_POSITION_X, x);
+		if (y != f->ry)
+			ret |= emit(tv, EV_ABS, ABS_MT_POSITION_Y, y);
+		f->rx = x;
+		f->ry = y;
+	}
+	if (mTypeA && !any)
+		ret |= emit(tv, EV_SYN, SYN_MT_REPORT, 0);
+	ret |= emit(tv, EV_SYN, SYN_REPORT, 0);
+	return ret;
+}
+
+static void step(double dt)
+{
+	struct finger *f;
+	int i;
+
+	for (i = 0; i < mFingers; i++) {
+		f = &mFinger[i];
+		f->left -= dt;
+		if (f->down) {
+			move(f, dt);
+			if (f->left <= 0) {
+				f->down = 0;
+				f->left = 0.05 + 0.3 * frand();
+			}
+		} else if (f->left <= 0) {
+			touch_down(f);
+		}
+	}
+}
+
+/* evemu description of the generated panel */
+static char *make_desc(size_t *len)
+{
+	static const int codes[] = {
+		ABS_MT_SLOT, ABS_MT_TOUCH_MAJOR, ABS_MT_POSITION_X,
+		ABS_MT_POSITION_Y, ABS_MT_TRACKING_ID
+	};
+	unsigned char abs[8];
+	char *desc = NULL;
+	FILE *fp;
+	int i;
+
+	fp = open_memstream(&desc, len);
+	if (!fp)
+		return NULL;
+	memset(abs, 0, sizeof(abs));
+	for (i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+		if (mTypeA && (codes[i] == ABS_MT_SLOT ||
+					   codes[i] == ABS_MT_TRACKING_ID))
+			continue;
+		abs[codes[i] / 8] |= 1 << (codes[i] % 8);
+	}
+	fprintf(fp, "N: jggen %s panel\n", mTypeA ? "type A" : "type B");
+	fprintf(fp, "I: 0006 0000 0000 0000\n");
+	fprintf(fp, "B: %02x %02x 00 00 00 00 00 00 00\n", EV_SYN,
+			(1 << EV_SYN) | (1 << EV_ABS));
+	fprintf(fp, "B: %02x %02x %02x %02x %02x %02x %02x %02x %02x\n", EV_ABS,
+			abs[0], abs[1], abs[2], abs[3], abs[4], abs[5], abs[6], abs[7]);
+	if (!mTypeA)
+		fprintf(fp, "A: %02x 0 %d 0 0\n", ABS_MT_SLOT, mFingers - 1);
+	fprintf(fp, "A: %02x 0 255 0 0\n", ABS_MT_TOUCH_MAJOR);
+	fprintf(fp, "A: %02x 0 %d 0 0\n", ABS_MT_POSITION_X, mXres - 1);
+	fprintf(fp, "A: %02x 0 %d 0 0\n", ABS_MT_POSITION_Y, mYres - 1);
+	if (!mTypeA)
+		fprintf(fp, "A: %02x 0 65535 0 0\n", ABS_MT_TRACKING_ID);
+	fclose(fp);
+	return desc;
+}
+
+static struct evemu_device *read_desc(char *desc, size_t len)
+{
+	struct evemu_device *dev;
+	FILE *fp;
+
+	fp = fmemopen(desc, len, "r");
+	if (!fp)
+		return NULL;
+	dev = evemu_new(NULL);
+	if (dev && evemu_read(dev, fp) <= 0) {
+		evemu_delete(dev);
+		dev = NULL;
+	}
+	fclose(fp);
+	return dev;
+}
+
+static int open_output(char *desc, size_t len)
+{
+	struct evemu_device *dev = NULL;
+	FILE *fp;
+	int ret = -1;
+
+	if (mOutput == OUT_BINARY) {
+		fp = fopen(mOutPath, "w");
+		if (!fp) {
+			perror(mOutPath);
+			return -1;
+		}
+		if (evrec_write_begin(&mWriter, fp, desc, len) < 0) {
+			fclose(fp);
+			return -1;
+		}
+		return 0;
+	}
+
+	dev = read_desc(desc, len);
+	if (!dev) {
+		fprintf(stderr, "error: bad device description\n");
+		return -1;
+	}
+	if (mOutput == OUT_TEXT) {
+		mpText = strcmp(mOutPath, "-") ? fopen(mOutPath, "w") : stdout;
+		if (!mpText)
+			perror(mOutPath);
+		else
+			ret = evemu_write(dev, mpText);
+	} else {
+		mUinputFd = open("/dev/uinput", O_WRONLY);
+		if (mUinputFd < 0)
+			perror("/dev/uinput");
+		else if ((ret = evemu_create(dev, mUinputFd)) < 0)
+			fprintf(stderr, "error: could not create uinput device\n");
+		else
+			sleep(1);	/* let readers find the new device */
+	}
+	evemu_delete(dev);
+	return ret;
+}
+
+static int close_output(void)
+{
+	FILE *fp;
+	int ret = 0;
+
+	switch (mOutput) {
+	case OUT_TEXT:
+		if (fflush(mpText) || (mpText != stdout && fclose(mpText)))
+			ret = -1;
+		break;
+	case OUT_BINARY:
+		fp = mWriter.fp;
+		ret = evrec_write_end(&mWriter);
+		if (fclose(fp))
+			ret = -1;
+		break;
+	default:
+		if (mUinputFd >= 0) {
+			evemu_destroy(mUinputFd);
+			close(mUinputFd);
+		}
+		break;
+	}
+	return ret;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n fingers] [-r hz] [-t seconds] [-A] "
+			"[-g WxH]\n"
+			"\t[-m none|uniform|gauss] [-j units] [-J us] [-s seed]\n"
+			"\t[-o text-out | -b binary-out | -u] [-p]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec t0, due;
+	struct timeval tv;
+	u_int64_t period, t, jitter;
+	unsigned long frame, nframes;
+	char *desc;
+	size_t len;
+	int opt, ret = 0;
+
+	srand(1);
+	while ((opt = getopt(argc, argv, "Ab:g:j:J:m:n:o:pr:s:t:u")) != -1) {
+		switch (opt) {
+		case 'A':
+			mTypeA = 1;
+			break;
+		case 'b':
+			mOutput = OUT_BINARY;
+			mOutPath = optarg;
+			break;
+		case 'g':
+			if (sscanf(optarg, "%dx%d", &mXres, &mYres) != 2 ||
+				mXres < 2 || mYres < 2) {
+				fprintf(stderr, "error: bad geometry %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'j':
+			mNoiseAmp = atof(optarg);
+			if (mNoise == NOISE_NONE)
+				mNoise = NOISE_GAUSS;
+			break;
+		case 'J':
+			mTimeJitter = atoi(optarg);
+			break;
+		case 'm':
+			if (strcmp(optarg, "none") == 0)
+				mNoise = NOISE_NONE;
+			else if (strcmp(optarg, "uniform") == 0)
+				mNoise = NOISE_UNIFORM;
+			else if (strcmp(optarg, "gauss") == 0)
+				mNoise = NOISE_GAUSS;
+			else {
+				fprintf(stderr, "error: unknown noise model %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'n':
+			mFingers = atoi(optarg);
+			if (mFingers < 1 || mFingers > GEN_MAX_FINGERS) {
+				fprintf(stderr, "error: fingers must be 1..%d\n",
+						GEN_MAX_FINGERS);
+				return -1;
+			}
+			break;
+		case 'o':
+			mOutput = OUT_TEXT;
+			mOutPath = optarg;
+			break;
+		case 'p':
+			mPaced = 1;
+			break;
+		case 'r':
+			mRate = atoi(optarg);
+			if (mRate < 60 || mRate > 1000) {
+				fprintf(stderr, "error: rate must be 60..1000 Hz\n");
+				return -1;
+			}
+			break;
+		case 's':
+			srand(atoi(optarg));
+			break;
+		case 't':
+			mDuration = atof(optarg);
+			break;
+		case 'u':
+			mOutput = OUT_UINPUT;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if (optind < argc || mDuration <= 0) {
+		usage(argv[0]);
+		return -1;
+	}
+	if (mOutput == OUT_UINPUT)
+		mPaced = 1;
+	if (mTimeJitter * 2 >= 1000000 / mRate)
+		mTimeJitter = 1000000 / mRate / 2 - 1;
+
+	desc = make_desc(&len);
+	if (!desc || open_output(desc, len) < 0) {
+		free(desc);
+		return -1;
+	}
+
+	period = 1000000000ULL / mRate;
+	nframes = mDuration * mRate;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (frame = 0; frame < nframes && ret == 0; frame++) {
+		t = frame * period;
+		if (mTimeJitter) {
+			jitter = (u_int64_t)rand() % (2 * mTimeJitter + 1) * 1000;
+			t = t + jitter > (u_int64_t)mTimeJitter * 1000 ?
+				t + jitter - mTimeJitter * 1000 : 0;
+		}
+		step(frame ? 1.0 / mRate : 0);
+		if (mPaced) {
+			due.tv_sec = t0.tv_sec + (t0.tv_nsec + t) / 1000000000;
+			due.tv_nsec = (t0.tv_nsec + t) % 1000000000;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+								   &due, NULL) == EINTR)
+				;
+			tv.tv_sec = due.tv_sec;
+			tv.tv_usec = due.tv_nsec / 1000;
+		} else {
+			tv.tv_sec = t / 1000000000;
+			tv.tv_usec = t % 1000000000 / 1000;
+		}
+		ret = report(&tv);
+	}
+	if (close_output() < 0)
+		ret = -1;
+	free(desc);
+	fprintf(stderr, "%lu frames, %lu events, %d fingers at %d Hz\n",
+			frame, mEvents, mFingers, mRate);
+	return ret;
+}
+/* EOF */
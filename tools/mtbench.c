@@ -0,0 +1,472 @@
+/*
+ * Microbenchmark and self-check of the mtdev contact matching code.
+ *
+ * The distance matrix is built for 1 to DIM_FINGER contacts with the
+ * scalar and the build's SIMD kernel, on random positions that also
+ * cover deltas beyond the 15 bit clamp. Results must be identical.
+ *
+ * The matchers are checked on random contact sets: the Hungarian
+ * mtdev_match() against a reference solver for every size, and
+ * match_four against both up to 4 x 4. All must reach the same
+ * optimal cost. They are then timed on random and worst-case layouts.
+ * Exits non-zero on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+
+#include "dist.h"
+
+#define NSETS	64		/* input sets cycled through while timing */
+#define NCHECK	2000	/* random matching problems per size */
+
+typedef void (*dist2_fn)(int *, const int *, const int *, int,
+						 const int *, const int *, int);
+
+struct coords {
+	int nx[DIM_FINGER], ny[DIM_FINGER];
+	int sx[DIM_FINGER], sy[DIM_FINGER];
+};
+
+static int mIterations = 100000;
+static struct coords mSets[NSETS];
+static volatile int mSink;
+
+static u_int64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u_int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* mostly nearby contacts, one in eight anywhere on a 16 bit surface */
+static int random_coord(int around)
+{
+	if (rand() % 8 == 0)
+		return rand() % 65536;
+	return around + rand() % 201 - 100;
+}
+
+static void fill_sets(void)
+{
+	struct coords *c;
+	int i;
+
+	for (c = mSets; c < mSets + NSETS; c++) {
+		for (i = 0; i < DIM_FINGER; i++) {
+			c->sx[i] = rand() % 4096;
+			c->sy[i] = rand() % 4096;
+			c->nx[i] = random_coord(c->sx[i]);
+			c->ny[i] = random_coord(c->sy[i]);
+		}
+	}
+}
+
+/* ns per matrix */
+static double time_dist2(dist2_fn fn, int n)
+{
+	int A[DIM2_FINGER];
+	const struct coords *c;
+	u_int64_t t;
+	int i;
+
+	t = now_ns();
+	for (i = 0; i < mIterations; i++) {
+		c = &mSets[i % NSETS];
+		fn(A, c->nx, c->ny, n, c->sx, c->sy, n);
+		mSink += A[n * n - 1];
+	}
+	return (double)(now_ns() - t) / mIterations;
+}
+
+static int check_dist2(int n)
+{
+	int A[DIM2_FINGER], B[DIM2_FINGER];
+	const struct coords *c;
+
+	for (c = mSets; c < mSets + NSETS; c++) {
+		mtdev_dist2_matrix_scalar(A, c->nx, c->ny, n, c->sx, c->sy, n);
+		mtdev_dist2_matrix(B, c->nx, c->ny, n, c->sx, c->sy, n);
+		if (memcmp(A, B, n * n * sizeof(A[0]))) {
+			fprintf(stderr, "error: dist2 mismatch at %d contacts\n", n);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* match_four sizes, up to 4 x 4 */
+static int check_dist1(void)
+{
+	struct trk_coord a[4], b[4];
+	unsigned int d[16], e[16];
+	const struct coords *c;
+	int na, nb, i;
+
+	for (c = mSets; c < mSets + NSETS; c++) {
+		for (i = 0; i < 4; i++) {
+			a[i].x = c->sx[i];
+			a[i].y = c->sy[i];
+			b[i].x = c->nx[i];
+			b[i].y = c->ny[i];
+		}
+		for (na = 1; na <= 4; na++) {
+			for (nb = 1; nb <= 4; nb++) {
+				mtdev_dist1_matrix_scalar(d, a, na, b, nb);
+				mtdev_dist1_matrix(e, a, na, b, nb);
+				if (memcmp(d, e, na * nb * sizeof(d[0]))) {
+					fprintf(stderr, "error: dist1 mismatch at %dx%d\n",
+							na, nb);
+					return -1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ * Reference assignment solver, shortest augmenting paths with
+ * potentials. A[row + nrow * col] as for mtdev_match(), nrow <= ncol.
+ */
+static long long ref_cost_wide(const int *A, int nrow, int ncol)
+{
+	long long u[DIM_FINGER + 1], v[DIM_FINGER + 1], minv[DIM_FINGER + 1];
+	int p[DIM_FINGER + 1], way[DIM_FINGER + 1], used[DIM_FINGER + 1];
+	long long cur, delta, cost = 0;
+	int i, j, i0, j0, j1;
+
+	memset(u, 0, sizeof(u));
+	memset(v, 0, sizeof(v));
+	memset(p, 0, sizeof(p));
+	for (i = 1; i <= nrow; i++) {
+		p[0] = i;
+		j0 = 0;
+		for (j = 0; j <= ncol; j++) {
+			minv[j] = LLONG_MAX;
+			used[j] = 0;
+		}
+		do {
+			used[j0] = 1;
+			i0 = p[j0];
+			delta = LLONG_MAX;
+			j1 = 0;
+			for (j = 1; j <= ncol; j++) {
+				if (used[j])
+					continue;
+				cur = A[(i0 - 1) + nrow * (j - 1)] - u[i0] - v[j];
+				if (cur < minv[j]) {
+					minv[j] = cur;
+					way[j] = j0;
+				}
+				if (minv[j] < delta) {
+					delta = minv[j];
+					j1 = j;
+				}
+			}
+			for (j = 0; j <= ncol; j++) {
+				if (used[j]) {
+					u[p[j]] += delta;
+					v[j] -= delta;
+				} else {
+					minv[j] -= delta;
+				}
+			}
+			j0 = j1;
+		} while (p[j0] != 0);
+		do {
+			j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		} while (j0);
+	}
+	for (j = 1; j <= ncol; j++)
+		if (p[j])
+			cost += A[(p[j] - 1) + nrow * (j - 1)];
+	return cost;
+}
+
+static long long ref_cost(const int *A, int nrow, int ncol)
+{
+	int T[DIM2_FINGER];
+	int row, col;
+
+	if (nrow <= ncol)
+		return ref_cost_wide(A, nrow, ncol);
+	for (row = 0; row < nrow; row++)
+		for (col = 0; col < ncol; col++)
+			T[col + ncol * row] = A[row + nrow * col];
+	return ref_cost_wide(T, ncol, nrow);
+}
+
+/* cost of ix, -1 unless it is a complete assignment */
+static long long ix_cost(const int *A, int nrow, int ncol, const int *ix)
+{
+	unsigned int taken = 0;
+	long long cost = 0;
+	int row, n = 0;
+
+	for (row = 0; row < nrow; row++) {
+		if (ix[row] < 0)
+			continue;
+		if (ix[row] >= ncol || (taken & (1U << ix[row])))
+			return -1;
+		taken |= 1U << ix[row];
+		cost += A[row + nrow * ix[row]];
+		n++;
+	}
+	return n == (nrow < ncol ? nrow : ncol) ? cost : -1;
+}
+
+/* match_four result: one byte per new contact, old index or unmatched */
+static long long four_cost(const unsigned int *d, int nslot, int npos,
+						   const unsigned char *p)
+{
+	int ix[4], i;
+
+	for (i = 0; i < npos; i++)
+		ix[i] = p[i] < nslot ? p[i] : -1;
+	return ix_cost((const int *)d, npos, nslot, ix);
+}
+
+static void random_problem(struct coords *c, int nrow, int ncol)
+{
+	int i;
+
+	/* a coarse grid makes ties common */
+	for (i = 0; i < ncol; i++) {
+		c->sx[i] = rand() % 64 * 16;
+		c->sy[i] = rand() % 64 * 16;
+	}
+	for (i = 0; i < nrow; i++) {
+		c->nx[i] = rand() % 64 * 16;
+		c->ny[i] = rand() % 64 * 16;
+	}
+}
+
+static int check_hungarian(int n)
+{
+	int A[DIM2_FINGER], B[DIM2_FINGER], ix[DIM_FINGER];
+	struct coords c;
+	long long want, got;
+	int i, nrow, ncol;
+
+	for (i = 0; i < NCHECK; i++) {
+		/* square, or a contact more or less than before */
+		ncol = n;
+		nrow = n + rand() % 3 - 1;
+		if (nrow < 1 || nrow > DIM_FINGER)
+			nrow = n;
+		random_problem(&c, nrow, ncol);
+		mtdev_dist2_matrix(A, c.nx, c.ny, nrow, c.sx, c.sy, ncol);
+		want = ref_cost(A, nrow, ncol);
+		if (mtdev_match_nearest(ix, A, nrow, ncol) &&
+			ix_cost(A, nrow, ncol, ix) != want) {
+			fprintf(stderr, "error: nearest not optimal at %dx%d\n",
+					nrow, ncol);
+			return -1;
+		}
+		memcpy(B, A, sizeof(A));
+		mtdev_match(ix, B, nrow, ncol);
+		got = ix_cost(A, nrow, ncol, ix);
+		if (got != want) {
+			fprintf(stderr, "error: hungarian cost %lld, optimum %lld "
+					"at %dx%d\n", got, want, nrow, ncol);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* match_four on its own metric, against the others */
+static int check_four(void)
+{
+	struct trk_coord old[4], pos[4];
+	unsigned int d[16];
+	int B[DIM2_FINGER], ix[DIM_FINGER];
+	long long want;
+	int i, k, nslot, npos;
+
+	for (i = 0; i < NCHECK; i++) {
+		for (nslot = 1; nslot <= 4; nslot++) {
+			for (npos = 1; npos <= 4; npos++) {
+				for (k = 0; k < 4; k++) {
+					old[k].x = rand() % 64 * 16;
+					old[k].y = rand() % 64 * 16;
+					pos[k].x = rand() % 64 * 16;
+					pos[k].y = rand() % 64 * 16;
+				}
+				mtdev_dist1_matrix(d, old, nslot, pos, npos);
+				want = ref_cost((const int *)d, npos, nslot);
+				memcpy(B, d, sizeof(d));
+				mtdev_match(ix, B, npos, nslot);
+				if (ix_cost((const int *)d, npos, nslot, ix) != want ||
+					four_cost(d, nslot, npos,
+							  mtdev_match_four(old, nslot, pos, npos)) != want) {
+					fprintf(stderr, "error: match_four disagrees at %dx%d\n",
+							npos, nslot);
+					return -1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+enum layout { LAYOUT_DRAG, LAYOUT_RANDOM, LAYOUT_LINE, LAYOUT_SAME, NLAYOUT };
+
+static const char *layout_name[NLAYOUT] = {
+	"drag", "random", "line", "same"
+};
+
+/*
+ * drag: every contact moved a little, the usual frame
+ * random: contacts anywhere, nothing to go by
+ * line: each new contact halfway between two old ones, ties everywhere
+ * same: all contacts on one spot, an all-zero matrix
+ */
+static void layout_problem(struct coords *c, enum layout l, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		switch (l) {
+		case LAYOUT_DRAG:
+			c->sx[i] = rand() % 4096;
+			c->sy[i] = rand() % 4096;
+			c->nx[i] = c->sx[i] + rand() % 9 - 4;
+			c->ny[i] = c->sy[i] + rand() % 9 - 4;
+			break;
+		case LAYOUT_RANDOM:
+			c->sx[i] = rand() % 4096;
+			c->sy[i] = rand() % 4096;
+			c->nx[i] = rand() % 4096;
+			c->ny[i] = rand() % 4096;
+			break;
+		case LAYOUT_LINE:
+			c->sx[i] = i * 64;
+			c->nx[i] = i * 64 + 32;
+			c->sy[i] = c->ny[i] = 1000;
+			break;
+		default:
+			c->sx[i] = c->nx[i] = 1000;
+			c->sy[i] = c->ny[i] = 1000;
+			break;
+		}
+	}
+}
+
+/* ns per solve() style match, fast path first if nearest is set */
+static double time_match(enum layout l, int n, int nearest, int iterations)
+{
+	int A[NSETS][DIM2_FINGER], B[DIM2_FINGER], ix[DIM_FINGER];
+	struct coords c;
+	u_int64_t t;
+	int i;
+
+	for (i = 0; i < NSETS; i++) {
+		layout_problem(&c, l, n);
+		mtdev_dist2_matrix(A[i], c.nx, c.ny, n, c.sx, c.sy, n);
+	}
+	t = now_ns();
+	for (i = 0; i < iterations; i++) {
+		if (nearest && mtdev_match_nearest(ix, A[i % NSETS], n, n)) {
+			mSink += ix[0];
+			continue;
+		}
+		memcpy(B, A[i % NSETS], n * n * sizeof(B[0]));
+		mtdev_match(ix, B, n, n);
+		mSink += ix[0];
+	}
+	return (double)(now_ns() - t) / iterations;
+}
+
+static double time_four(int n, int iterations)
+{
+	struct trk_coord old[NSETS][4], pos[NSETS][4];
+	u_int64_t t;
+	int i, k;
+
+	for (i = 0; i < NSETS; i++) {
+		for (k = 0; k < 4; k++) {
+			old[i][k].x = rand() % 4096;
+			old[i][k].y = rand() % 4096;
+			pos[i][k].x = old[i][k].x + rand() % 9 - 4;
+			pos[i][k].y = old[i][k].y + rand() % 9 - 4;
+		}
+	}
+	t = now_ns();
+	for (i = 0; i < iterations; i++)
+		mSink += *mtdev_match_four(old[i % NSETS], n, pos[i % NSETS], n);
+	return (double)(now_ns() - t) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	double ts, tv;
+	int opt, n, l, niter, ret = 0;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			mIterations = atoi(optarg);
+			if (mIterations < 1)
+				mIterations = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n iterations]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	srand(1);
+	fill_sets();
+	if (check_dist1() < 0)
+		ret = -1;
+
+	fprintf(stdout, "distance matrix, %s kernel, %d iterations\n",
+			mtdev_dist_impl, mIterations);
+	fprintf(stdout, "contacts  scalar(ns)  %s(ns)  speedup\n",
+			mtdev_dist_impl);
+	for (n = 1; n <= DIM_FINGER; n++) {
+		if (check_dist2(n) < 0) {
+			ret = -1;
+			continue;
+		}
+		ts = time_dist2(mtdev_dist2_matrix_scalar, n);
+		tv = time_dist2(mtdev_dist2_matrix, n);
+		fprintf(stdout, "%8d  %10.1f  %8.1f  %7.2f\n", n, ts, tv, ts / tv);
+	}
+
+	if (check_four() < 0)
+		ret = -1;
+	for (n = 1; n <= DIM_FINGER; n++)
+		if (check_hungarian(n) < 0)
+			ret = -1;
+	fprintf(stdout, "\nmatchers against the reference solver, %d problems "
+			"per size: %s\n", NCHECK, ret < 0 ? "FAILED" : "ok");
+
+	/* the O(n^3) solver gets fewer rounds */
+	niter = mIterations / 100 > 0 ? mIterations / 100 : 1;
+	fprintf(stdout, "\nmatching (ns), %d iterations, hungarian / with "
+			"nearest fast path\n", niter);
+	fprintf(stdout, "contacts");
+	for (l = 0; l < NLAYOUT; l++)
+		fprintf(stdout, "  %15s", layout_name[l]);
+	fprintf(stdout, "  %10s\n", "match_four");
+	for (n = 1; n <= DIM_FINGER; n++) {
+		fprintf(stdout, "%8d", n);
+		for (l = 0; l < NLAYOUT; l++)
+			fprintf(stdout, "  %7.0f/%-7.0f", time_match(l, n, 0, niter),
+					time_match(l, n, 1, niter));
+		if (n <= 4)
+			fprintf(stdout, "  %10.1f", time_four(n, niter));
+		fprintf(stdout, "\n");
+	}
+	return ret;
+}
+/* EOF */
@@ -57,7 +57,7 @@ int utouch_frame_is_supported_mtdev(const struct evemu_device *dev)
 }
 
 #if defined(JPANEL_TOUCHSCREEN)
-static void print_surface(struct utouch_surface *s)
+static void __attribute__((unused)) print_surface(struct utouch_surface *s)
 {
 	printf("utouch surface:needs_pointer=%d\n",s->needs_pointer);
 	printf("utouch surface:is_direct=%d\n",s->is_direct);
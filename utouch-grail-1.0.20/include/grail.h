@@ -177,6 +177,35 @@ struct grail {
  */
 int grail_open(struct grail *ge, int fd);
 
+#if defined(JPANEL_TOUCHSCREEN)
+/**
+ * grail_open_surface - open a grail device without a kernel device
+ * @ge: the grail device to open
+ * @min: the minimum corner of the surface (device units)
+ * @max: the maximum corner of the surface (device units)
+ * @pbox: the physical size of the surface (mm)
+ *
+ * Like grail_open(), but the events come from the caller through
+ * grail_pump(), already converted to MT type B (mtdev). Close with
+ * grail_close() and a negative fd.
+ *
+ * Returns zero on success, negative error number otherwise.
+ */
+int grail_open_surface(struct grail *ge,
+		       const struct grail_coord *min,
+		       const struct grail_coord *max,
+		       const struct grail_coord *pbox);
+
+/**
+ * grail_pump - process one event
+ * @ge: the grail device in use
+ * @ev: the (type B) event
+ *
+ * The grail callbacks are invoked during this call.
+ */
+void grail_pump(struct grail *ge, const struct input_event *ev);
+#endif
+
 /**
  * grail_idle - check state of kernel device
  * @ge: the grail device in use
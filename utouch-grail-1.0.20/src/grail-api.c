@@ -99,6 +99,60 @@ int grail_open(struct grail *ge, int fd)
 	return ret;
 }
 
+#if defined(JPANEL_TOUCHSCREEN)
+int grail_open_surface(struct grail *ge,
+		       const struct grail_coord *min,
+		       const struct grail_coord *max,
+		       const struct grail_coord *pbox)
+{
+	struct grail_impl *x;
+	struct utouch_surface *s;
+	int ret;
+	x = calloc(1, sizeof(*x));
+	if (!x)
+		return -ENOMEM;
+
+	x->fh = utouch_frame_new_engine(DIM_FRAMES, DIM_TOUCH, FRAME_RATE);
+	if (!x->fh) {
+		ret = -ENOMEM;
+		goto freemem;
+	}
+	s = utouch_frame_get_surface(x->fh);
+	s->is_direct = 1;
+	s->min_x = s->mapped_min_x = min->x;
+	s->min_y = s->mapped_min_y = min->y;
+	s->max_x = s->mapped_max_x = max->x;
+	s->max_y = s->mapped_max_y = max->y;
+	s->phys_width = pbox->x;
+	s->phys_height = pbox->y;
+	s->max_pressure = s->mapped_max_pressure = 256;
+	s->phys_pressure = 10;
+	s->max_orient = 1;
+	s->min_id = MT_ID_MIN;
+	s->max_id = MT_ID_MAX;
+
+	ge->impl = x;
+
+	ret = gin_init(ge);
+	if (ret)
+		goto freeframe;
+
+	ret = gru_init(ge);
+	if (ret)
+		goto freegin;
+
+	return 0;
+ freegin:
+	gin_destroy(ge);
+ freeframe:
+	utouch_frame_delete_engine(x->fh);
+ freemem:
+	free(x);
+	ge->impl = 0;
+	return ret;
+}
+#endif
+
 void grail_close(struct grail *ge, int fd)
 {
 	struct grail_impl *x = ge->impl;
@@ -219,7 +273,6 @@ static void report_frame(struct grail *ge,
 			 const struct input_event *syn)
 {
 	struct grail_impl *impl = ge->impl;
-	struct grail_event gev;
 
 	ge->impl->frame = frame;
 
@@ -242,6 +295,7 @@ static void report_frame(struct grail *ge,
 		impl->ongoing &= impl->gesture;
 }
 
+#if !defined(JPANEL_TOUCHSCREEN)
 static void report_frame_raw(const struct utouch_frame *frame)
 {
 	int i;
@@ -268,11 +322,12 @@ static void report_frame_raw(const struct utouch_frame *frame)
 
 	fprintf(stderr, "sync %d %012llx %d %d %d\n",
 					frame->num_active,
-					frame->time,
+					(unsigned long long)frame->time,
 					frame->sequence_id,
 					frame->revision,
 					frame->slot_revision);
 }
+#endif
 
 static void grail_pump_mtdev(struct grail *ge, const struct input_event *ev)
 {
@@ -299,12 +354,19 @@ static void grail_pump_mtdev(struct grail *ge, const struct input_event *ev)
 	}
 }
 
+#if defined(JPANEL_TOUCHSCREEN)
+void grail_pump(struct grail *ge, const struct input_event *ev)
+{
+	grail_pump_mtdev(ge, ev);
+}
+#endif
+
 #define NUM_EVENTS 8
 int grail_pull(struct grail *ge, int fd)
 {
 	struct grail_impl *impl = ge->impl;
 	struct input_event ev[NUM_EVENTS];
-	int ret, count = 0, i, len = sizeof(ev);
+	int count = 0, i, len = sizeof(ev);
 
 	while (len == sizeof(ev)) {
 		len = mtdev_get(impl->mtdev, fd, ev, NUM_EVENTS) *
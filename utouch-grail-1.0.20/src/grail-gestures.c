@@ -163,7 +163,9 @@ static void move_update(struct move_model *m, int i, float x, grail_time_t t)
 
 void gru_init_motion(struct grail *ge)
 {
+#if !defined(JPANEL_TOUCHSCREEN)
 	struct utouch_surface *s = utouch_frame_get_surface(ge->impl->fh);
+#endif
 	struct gesture_recognizer *gru = ge->gru;
 	struct move_model *m = &gru->move;
 	float D[DIM_FM];